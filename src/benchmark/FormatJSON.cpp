@@ -0,0 +1,175 @@
+#include "FormatJSON.h"
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+// The helpers below are the ones `json.h` had, with their types renamed so
+//  they don't clash with `TypeRecord.h`.
+namespace {
+
+std::string json_from_vector(const std::vector<std::string> &elements) {
+  std::string json = "[";
+  for (const auto &element : elements) {
+    json += std::format(R"("{}",)", element);
+  }
+  if (!elements.empty()) {
+    json.pop_back(); // Remove the last comma
+  }
+  json += "]";
+  return json;
+}
+
+typedef std::pair<std::optional<std::string>, std::string> FormatTypeRef;
+std::string json_decl_id_and_type_name(const FormatTypeRef &declIDAndTypeName) {
+  const auto &declID = declIDAndTypeName.first;
+  const auto &typeName = declIDAndTypeName.second;
+  return declID ? std::format(R"({{"declID":"{}","typeName":"{}"}})", *declID,
+                              typeName)
+                : std::format(R"({{"declID":null,"typeName":"{}"}})", typeName);
+}
+
+typedef std::vector<std::pair<std::string, FormatTypeRef>> OrderedTypesMap;
+
+std::string json_ordered_types_map(const OrderedTypesMap &types) {
+  std::string json = "[";
+  for (const auto &pair : types) {
+    auto typeIDAndName = json_decl_id_and_type_name(pair.second);
+    json +=
+        std::format(R"({{"name":"{}","type":{}}},)", pair.first, typeIDAndName);
+  }
+  if (!types.empty()) {
+    json.pop_back(); // Remove the last comma
+  }
+  json += "]";
+  return json;
+}
+
+std::string json_type_decl(const std::string &kind,
+                           const FormatTypeRef &declIDAndTypeName,
+                           std::string &properties,
+                           const std::string &pseudoRoot,
+                           const std::vector<std::string> &location) {
+  const auto declIDAndTypeNameStr =
+      json_decl_id_and_type_name(declIDAndTypeName);
+  properties.replace(properties.find('{'), 1,
+                     std::format(R"({{"kind":"{}",)", kind));
+  return std::format(
+      R"({{"type":{},"properties":{},"pseudoRoot":"{}","location":{}}})",
+      declIDAndTypeNameStr, properties, pseudoRoot, json_from_vector(location));
+}
+
+typedef std::tuple<int64_t, int64_t, FormatTypeRef> FormatStructField;
+std::string json_struct_field(const FormatStructField &field) {
+  auto [offset, size, declIDAndTypeName] = field;
+  auto declIDAndTypeNameStr = json_decl_id_and_type_name(declIDAndTypeName);
+  return std::format(R"({{"offset":{},"size":{},"type":{}}})", offset, size,
+                     declIDAndTypeNameStr);
+}
+
+std::string json_struct_fields(
+    const std::vector<std::pair<std::string, FormatStructField>> &fields) {
+  if (fields.empty()) {
+    return "[]"; // Return empty array if no fields
+  }
+  std::vector<std::string> fieldJsons(fields.size());
+  std::transform(fields.begin(), fields.end(), fieldJsons.begin(),
+                 [](const std::pair<std::string, FormatStructField> &pair) {
+                   return std::format(R"("name":"{}","field":{})", pair.first,
+                                      json_struct_field(pair.second));
+                 });
+  std::string json = "[";
+  for (const auto &fieldJson : fieldJsons) {
+    json += std::format(R"({{{}}},)", fieldJson);
+  }
+  json.pop_back(); // Remove the last comma
+  json += "]";
+  return json;
+}
+
+typedef std::pair<std::string, uint64_t> FormatEnumEntry;
+
+std::string json_enum_entries(const std::vector<FormatEnumEntry> &entries) {
+  if (entries.empty()) {
+    return "[]"; // Return empty array if no entries
+  }
+  std::string json = "[";
+  for (const auto &entry : entries) {
+    json += std::format(R"({{"name":"{}","value":{}}},)", entry.first,
+                        entry.second);
+  }
+  json.pop_back(); // Remove the last comma
+  json += "]";
+  return json;
+}
+
+FormatTypeRef toFormatTypeRef(const DeclIDAndTypeName &type) {
+  std::optional<std::string> declID;
+  if (type.declID) {
+    declID = type.declID->str();
+  }
+  return {declID, type.typeName.str()};
+}
+
+OrderedTypesMap toOrderedTypesMap(llvm::ArrayRef<NamedType> types) {
+  OrderedTypesMap map;
+  for (const auto &type : types) {
+    map.push_back({type.name.str(), toFormatTypeRef(type.type)});
+  }
+  return map;
+}
+
+} // namespace
+
+std::string formatTypeRecordJSON(const TypeRecord &record) {
+  auto type = toFormatTypeRef(record.type);
+  auto pseudoRoot = record.pseudoRoot.str();
+  std::vector<std::string> location;
+  for (const auto &component : record.location) {
+    location.push_back(component.str());
+  }
+
+  std::string properties;
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    properties = std::format(
+        R"({{"underlyingType":{}}})",
+        json_decl_id_and_type_name(toFormatTypeRef(record.underlyingType)));
+    break;
+  case TypeKind::Struct: {
+    std::vector<std::pair<std::string, FormatStructField>> fields;
+    for (const auto &field : record.fields) {
+      fields.push_back({field.name.str(),
+                        {field.offset, field.size,
+                         toFormatTypeRef(field.type)}});
+    }
+    properties = std::format(R"({{"fields":{}}})", json_struct_fields(fields));
+    break;
+  }
+  case TypeKind::Union:
+    properties =
+        std::format(R"({{"members":{}}})",
+                    json_ordered_types_map(toOrderedTypesMap(record.members)));
+    break;
+  case TypeKind::Enum: {
+    std::vector<FormatEnumEntry> entries;
+    for (const auto &entry : record.entries) {
+      entries.push_back({entry.name.str(), entry.value});
+    }
+    properties = std::format(
+        R"({{"backingType":{},"entries":{}}})",
+        json_decl_id_and_type_name(toFormatTypeRef(record.backingType)),
+        json_enum_entries(entries));
+    break;
+  }
+  case TypeKind::Function:
+    properties = std::format(
+        R"({{"returnType":{},"params":{}}})",
+        json_decl_id_and_type_name(toFormatTypeRef(record.returnType)),
+        json_ordered_types_map(toOrderedTypesMap(record.params)));
+    break;
+  }
+  return json_type_decl(typeKindName(record.kind).str(), type, properties,
+                        pseudoRoot, location);
+}
@@ -0,0 +1,13 @@
+#include "TypeRecord.h"
+#include <string>
+
+#ifndef TYPE_EXTRACTOR_FORMAT_JSON_H
+#define TYPE_EXTRACTOR_FORMAT_JSON_H
+
+// Serialize the record the way the extractor did before records were
+//  streamed (building nested `std::format` strings, from `std::string`
+//  copies of everything), as a baseline for the JSON benchmark. The output
+//  has no hash and no escaping, like it didn't then.
+std::string formatTypeRecordJSON(const TypeRecord &record);
+
+#endif // TYPE_EXTRACTOR_FORMAT_JSON_H
@@ -0,0 +1,111 @@
+#include "SyntheticHeader.h"
+#include <llvm/Support/raw_ostream.h>
+
+// Name of the last typedef in a chain, which the other types use.
+static void writeChainName(llvm::raw_ostream &OS,
+                           const SyntheticHeaderOptions &options,
+                           unsigned chain) {
+  OS << "synth_chain_" << chain << "_" << options.typedefChainLength - 1;
+}
+
+// Write the type of the given field of struct `index`, cycling through the
+//  kinds of types a real header uses.
+static void writeFieldType(llvm::raw_ostream &OS,
+                           const SyntheticHeaderOptions &options,
+                           unsigned index, unsigned field) {
+  switch ((index + field) % 6) {
+  case 0:
+    OS << "int";
+    break;
+  case 1:
+    OS << "unsigned long";
+    break;
+  case 2:
+    // Points at the previous struct, or at itself for the first one.
+    OS << "struct synth_struct_" << (index ? index - 1 : 0) << " *";
+    break;
+  case 3:
+    if (options.enums) {
+      OS << "enum synth_enum_" << (index + field) % options.enums;
+    } else {
+      OS << "int";
+    }
+    break;
+  case 4:
+    if (options.typedefChains && options.typedefChainLength) {
+      writeChainName(OS, options, (index + field) % options.typedefChains);
+    } else {
+      OS << "long";
+    }
+    break;
+  case 5:
+    OS << "const char *";
+    break;
+  }
+}
+
+static void writeStructBody(llvm::raw_ostream &OS,
+                            const SyntheticHeaderOptions &options,
+                            unsigned index, unsigned depth) {
+  std::string indent((options.depth - depth + 1) * 2, ' ');
+  OS << "{\n";
+  for (unsigned field = 0; field < options.fields; ++field) {
+    OS << indent;
+    writeFieldType(OS, options, index, field);
+    OS << " field_" << field;
+    if ((index + field) % 6 == 1) {
+      OS << "[4]";
+    }
+    OS << ";\n";
+  }
+  if (depth > 0) {
+    OS << indent << "struct ";
+    writeStructBody(OS, options, index, depth - 1);
+    OS << " nested;\n";
+  }
+  OS << std::string(indent.size() - 2, ' ') << "}";
+}
+
+std::string generateSyntheticHeader(const SyntheticHeaderOptions &options) {
+  std::string header;
+  llvm::raw_string_ostream OS(header);
+
+  for (unsigned i = 0; i < options.enums; ++i) {
+    OS << "enum synth_enum_" << i << " {";
+    for (unsigned entry = 0; entry < 8; ++entry) {
+      OS << " SYNTH_ENUM_" << i << "_" << entry << " = " << entry * 4 << ",";
+    }
+    OS << " };\n";
+  }
+
+  for (unsigned chain = 0; chain < options.typedefChains; ++chain) {
+    for (unsigned link = 0; link < options.typedefChainLength; ++link) {
+      OS << "typedef ";
+      if (link == 0) {
+        OS << "unsigned int";
+      } else {
+        OS << "synth_chain_" << chain << "_" << link - 1;
+      }
+      OS << " synth_chain_" << chain << "_" << link << ";\n";
+    }
+  }
+
+  for (unsigned i = 0; i < options.structs; ++i) {
+    OS << "struct synth_struct_" << i << " ";
+    writeStructBody(OS, options, i, options.depth);
+    OS << ";\n";
+  }
+
+  for (unsigned i = 0; i < options.functions; ++i) {
+    OS << "int synth_function_" << i << "(";
+    if (options.structs) {
+      OS << "struct synth_struct_" << i % options.structs << " *a, ";
+    }
+    if (options.typedefChains && options.typedefChainLength) {
+      writeChainName(OS, options, i % options.typedefChains);
+      OS << " b, ";
+    }
+    OS << "const char *c);\n";
+  }
+  return header;
+}
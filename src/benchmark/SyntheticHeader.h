@@ -0,0 +1,24 @@
+#include <string>
+
+#ifndef TYPE_EXTRACTOR_SYNTHETIC_HEADER_H
+#define TYPE_EXTRACTOR_SYNTHETIC_HEADER_H
+
+// The shape of a generated header.
+struct SyntheticHeaderOptions {
+  unsigned structs = 1000;
+  // Fields per struct (and per nested struct).
+  unsigned fields = 8;
+  // How deeply structs are nested inside each struct.
+  unsigned depth = 2;
+  unsigned enums = 200;
+  // Number of typedef chains, and the number of typedefs in each.
+  unsigned typedefChains = 200;
+  unsigned typedefChainLength = 4;
+  unsigned functions = 1000;
+};
+
+// Generate a self-contained C header, whose types reference each other
+//  (including through pointers and typedef chains) like a real SDK's do.
+std::string generateSyntheticHeader(const SyntheticHeaderOptions &options);
+
+#endif // TYPE_EXTRACTOR_SYNTHETIC_HEADER_H
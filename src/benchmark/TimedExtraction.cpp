@@ -0,0 +1,136 @@
+#include "TimedExtraction.h"
+#include "RecordSink.h"
+#include <chrono>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/MD5.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Discards everything written to it, besides its MD5.
+class DigestStream : public llvm::raw_ostream {
+private:
+  llvm::MD5 Hash;
+  uint64_t Position = 0;
+
+  void write_impl(const char *ptr, size_t size) override {
+    Hash.update(llvm::StringRef(ptr, size));
+    Position += size;
+  }
+  uint64_t current_pos() const override { return Position; }
+
+public:
+  ~DigestStream() override { flush(); }
+
+  std::string digest() {
+    flush();
+    llvm::MD5::MD5Result result;
+    Hash.final(result);
+    return result.digest().str().str();
+  }
+};
+
+// Serializes records like the default output does, timing it.
+class TimingSink : public RecordSink {
+private:
+  llvm::raw_ostream &OS;
+  JSONStreamSink Output;
+  ExtractionTimings &Timings;
+
+public:
+  TimingSink(llvm::raw_ostream &OS, ExtractionTimings &timings)
+      : OS(OS), Output(OS), Timings(timings) {}
+
+  void handleRecord(const TypeRecord &record) override {
+    auto start = Clock::now();
+    Output.handleRecord(record);
+    Timings.serializationSeconds += secondsSince(start);
+    Timings.records++;
+  }
+
+  void finish() override {
+    auto start = Clock::now();
+    Output.finish();
+    Timings.serializationSeconds += secondsSince(start);
+    Timings.bytes = OS.tell();
+  }
+};
+
+// Forwards to the extractor's consumer, timing the traversal.
+class TimingConsumer : public clang::ASTConsumer {
+private:
+  std::unique_ptr<clang::ASTConsumer> Consumer;
+  double &Seconds;
+
+public:
+  TimingConsumer(std::unique_ptr<clang::ASTConsumer> consumer,
+                 double &seconds)
+      : Consumer(std::move(consumer)), Seconds(seconds) {}
+
+  void Initialize(clang::ASTContext &Context) override {
+    Consumer->Initialize(Context);
+  }
+
+  bool HandleTopLevelDecl(clang::DeclGroupRef D) override {
+    return Consumer->HandleTopLevelDecl(D);
+  }
+
+  void HandleTranslationUnit(clang::ASTContext &Context) override {
+    auto start = Clock::now();
+    Consumer->HandleTranslationUnit(Context);
+    Seconds += secondsSince(start);
+  }
+};
+
+class TimingAction : public TypeExtractorAction {
+private:
+  double &Seconds;
+
+public:
+  TimingAction(RecordSink &sink, const ExtractorOptions &options,
+               double &seconds)
+      : TypeExtractorAction(sink, options), Seconds(seconds) {}
+
+  std::unique_ptr<clang::ASTConsumer>
+  CreateASTConsumer(clang::CompilerInstance &CI,
+                    llvm::StringRef file) override {
+    return std::make_unique<TimingConsumer>(
+        TypeExtractorAction::CreateASTConsumer(CI, file), Seconds);
+  }
+};
+
+} // namespace
+
+ExtractionTimings runTimedExtraction(llvm::StringRef code,
+                                     const std::vector<std::string> &args,
+                                     const ExtractorOptions &options,
+                                     bool digestOutput) {
+  ExtractionTimings timings;
+  llvm::raw_null_ostream nullStream;
+  DigestStream digestStream;
+  llvm::raw_ostream &OS =
+      digestOutput ? static_cast<llvm::raw_ostream &>(digestStream)
+                   : nullStream;
+  OS.SetBufferSize(64 * 1024);
+  TimingSink sink(OS, timings);
+  double handleSeconds = 0;
+
+  auto start = Clock::now();
+  timings.success = clang::tooling::runToolOnCodeWithArgs(
+      std::make_unique<TimingAction>(sink, options, handleSeconds), code,
+      args, "header.h");
+  timings.totalSeconds = secondsSince(start);
+  if (digestOutput) {
+    timings.outputDigest = digestStream.digest();
+  }
+  timings.parseSeconds = timings.totalSeconds - handleSeconds;
+  timings.traversalSeconds = handleSeconds - timings.serializationSeconds;
+  return timings;
+}
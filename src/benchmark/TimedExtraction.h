@@ -0,0 +1,34 @@
+#include "TypeExtractorAction.h"
+#include <cstdint>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_TIMED_EXTRACTION_H
+#define TYPE_EXTRACTOR_TIMED_EXTRACTION_H
+
+struct ExtractionTimings {
+  bool success = false;
+  uint64_t records = 0;
+  // Bytes of JSON output.
+  uint64_t bytes = 0;
+  // Everything besides handling the AST: mostly the driver, header search,
+  //  preprocessing and parsing.
+  double parseSeconds = 0;
+  // Walking the AST and building records, excluding serialization.
+  double traversalSeconds = 0;
+  double serializationSeconds = 0;
+  double totalSeconds = 0;
+  // MD5 of the output, in hex, if it was asked for.
+  std::string outputDigest;
+};
+
+// Extract `code` (as the default JSON output, written to a null stream),
+//  timing each stage. With `digestOutput`, the output is hashed as well, at
+//  the expense of serialization time.
+ExtractionTimings runTimedExtraction(llvm::StringRef code,
+                                     const std::vector<std::string> &args,
+                                     const ExtractorOptions &options = {},
+                                     bool digestOutput = false);
+
+#endif // TYPE_EXTRACTOR_TIMED_EXTRACTION_H
@@ -0,0 +1,394 @@
+#include "FormatJSON.h"
+#include "SyntheticHeader.h"
+#include "TimedExtraction.h"
+#include "TypeRecord.h"
+#include "json.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <new>
+#include <optional>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+// Count every heap allocation in the process, so that benchmarks can report
+//  allocations per record.
+static std::atomic<uint64_t> allocationCount = 0;
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+// Synthetic records, shaped like the ones a typical SDK header produces.
+static std::vector<TypeRecord> makeSyntheticRecords() {
+  static const llvm::StringRef location[] = {"System", "Library",
+                                             "Frameworks", "Foo.framework",
+                                             "Headers", "Foo.h"};
+  static const llvm::StringRef fieldNames[] = {
+      "version", "flags", "name", "next", "buffer", "length", "state", "data"};
+  static const DeclIDAndTypeName types[] = {
+      {std::nullopt, "uint32_t"},
+      {std::nullopt, "const char *"},
+      {llvm::StringRef("c:@S@foo_state"), "foo_state"},
+      {std::nullopt, "void *"},
+  };
+
+  std::vector<TypeRecord> records(3);
+  for (auto &record : records) {
+    record.pseudoRoot = "Sysroot";
+    record.location.append(std::begin(location), std::end(location));
+  }
+
+  auto &structRecord = records[0];
+  structRecord.kind = TypeKind::Struct;
+  structRecord.type = {llvm::StringRef("c:@S@foo_context"), "foo_context"};
+  for (int i = 0; i < 16; ++i) {
+    structRecord.fields.push_back(
+        {fieldNames[i % 8], i * 64, 64, types[i % 4]});
+  }
+
+  auto &enumRecord = records[1];
+  enumRecord.kind = TypeKind::Enum;
+  enumRecord.type = {llvm::StringRef("c:@E@foo_mode"), "foo_mode"};
+  enumRecord.backingType = {std::nullopt, "unsigned int"};
+  for (uint64_t i = 0; i < 8; ++i) {
+    enumRecord.entries.push_back({fieldNames[i], i});
+  }
+
+  auto &functionRecord = records[2];
+  functionRecord.kind = TypeKind::Function;
+  functionRecord.type = {llvm::StringRef("c:@F@foo_open"), "foo_open"};
+  functionRecord.returnType = types[0];
+  for (int i = 0; i < 4; ++i) {
+    functionRecord.params.push_back({fieldNames[i], types[i]});
+  }
+  return records;
+}
+
+// Serialize synthetic records to a null stream (through a buffer the size of
+//  stdout's), reporting throughput and allocations per record, both for the
+//  streaming writer and for the `std::format` one it replaced.
+static int runJSONBenchmark(uint64_t recordCount) {
+  auto records = makeSyntheticRecords();
+  struct Result {
+    uint64_t bytes;
+    double recordsPerSecond;
+    double allocationsPerRecord;
+  };
+  auto measure = [&](auto &&write) {
+    llvm::raw_null_ostream nullStream;
+    nullStream.SetBufferSize(64 * 1024);
+    auto startAllocations = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < recordCount; ++i) {
+      write(nullStream, records[i % records.size()]);
+      nullStream << "\n";
+    }
+    nullStream.flush();
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    auto allocations = allocationCount.load() - startAllocations;
+    return Result{nullStream.tell(), recordCount / elapsed,
+                  double(allocations) / recordCount};
+  };
+  auto streaming = measure([](llvm::raw_ostream &OS, const TypeRecord &record) {
+    json_type_record(OS, record);
+  });
+  auto baseline = measure([](llvm::raw_ostream &OS, const TypeRecord &record) {
+    OS << formatTypeRecordJSON(record);
+  });
+
+  llvm::outs() << "records:               " << recordCount << "\n";
+  llvm::outs() << "bytes:                 " << streaming.bytes
+               << " (std::format: " << baseline.bytes << ")\n";
+  llvm::outs() << "records/sec:           "
+               << llvm::format("%.0f", streaming.recordsPerSecond)
+               << " (std::format: "
+               << llvm::format("%.0f", baseline.recordsPerSecond) << ", "
+               << llvm::format("%.1fx", streaming.recordsPerSecond /
+                                            baseline.recordsPerSecond)
+               << " faster)\n";
+  llvm::outs() << "allocations/record:    "
+               << llvm::format("%.3f", streaming.allocationsPerRecord)
+               << " (std::format: "
+               << llvm::format("%.3f", baseline.allocationsPerRecord)
+               << ")\n";
+  return 0;
+}
+
+// Peak resident set size of the process so far, in bytes.
+static uint64_t getPeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return uint64_t(usage.ru_maxrss); // Already in bytes.
+#else
+  return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Extract `code` and report each stage. Fails if the extraction fails or
+//  falls below the given throughput.
+static int runExtractionBenchmark(llvm::StringRef code,
+                                  const std::vector<std::string> &args,
+                                  const ExtractorOptions &options,
+                                  double minRecordsPerSecond) {
+  auto timings = runTimedExtraction(code, args, options);
+  double recordsPerSecond = timings.records / timings.totalSeconds;
+  auto milliseconds = [](double seconds) {
+    return llvm::format("%.1f ms", seconds * 1000);
+  };
+
+  llvm::outs() << "input bytes:           " << code.size() << "\n";
+  llvm::outs() << "records:               " << timings.records << "\n";
+  llvm::outs() << "output bytes:          " << timings.bytes << "\n";
+  llvm::outs() << "parse:                 "
+               << milliseconds(timings.parseSeconds) << "\n";
+  llvm::outs() << "traversal:             "
+               << milliseconds(timings.traversalSeconds) << "\n";
+  llvm::outs() << "serialization:         "
+               << milliseconds(timings.serializationSeconds) << "\n";
+  llvm::outs() << "total:                 "
+               << milliseconds(timings.totalSeconds) << "\n";
+  llvm::outs() << "records/sec:           "
+               << llvm::format("%.0f", recordsPerSecond) << "\n";
+  llvm::outs() << "output bytes/sec:      "
+               << llvm::format("%.0f", timings.bytes / timings.totalSeconds)
+               << "\n";
+  llvm::outs() << "peak RSS:              "
+               << llvm::format("%.1f MB", getPeakRSS() / (1024.0 * 1024.0))
+               << "\n";
+
+  if (!timings.success) {
+    llvm::errs() << "te-bench: extraction failed\n";
+    return 1;
+  }
+  if (recordsPerSecond < minRecordsPerSecond) {
+    llvm::errs() << "te-bench: below the target of "
+                 << llvm::format("%.0f", minRecordsPerSecond)
+                 << " records/sec\n";
+    return 1;
+  }
+  return 0;
+}
+
+// Extract `code` with the default and the extract frontend profiles, and
+//  report how much sooner parsing is done with the latter. Fails if either
+//  extraction fails or if their output differs.
+static int runProfileComparison(llvm::StringRef code,
+                                const std::vector<std::string> &args) {
+  ExtractorOptions options;
+  auto defaultTimings =
+      runTimedExtraction(code, args, options, /*digestOutput=*/true);
+  options.frontendProfile = FrontendProfile::Extract;
+  auto extractTimings =
+      runTimedExtraction(code, args, options, /*digestOutput=*/true);
+  auto milliseconds = [](double seconds) {
+    return llvm::format("%.1f ms", seconds * 1000);
+  };
+  auto reduction = [](double before, double after) {
+    return llvm::format("%.1f%%", before > 0 ? 100 * (1 - after / before) : 0);
+  };
+
+  llvm::outs() << "input bytes:           " << code.size() << "\n";
+  llvm::outs() << "records:               " << defaultTimings.records << "\n";
+  llvm::outs() << "parse (default):       "
+               << milliseconds(defaultTimings.parseSeconds) << "\n";
+  llvm::outs() << "parse (extract):       "
+               << milliseconds(extractTimings.parseSeconds) << "\n";
+  llvm::outs() << "parse reduction:       "
+               << reduction(defaultTimings.parseSeconds,
+                            extractTimings.parseSeconds)
+               << "\n";
+  llvm::outs() << "total (default):       "
+               << milliseconds(defaultTimings.totalSeconds) << "\n";
+  llvm::outs() << "total (extract):       "
+               << milliseconds(extractTimings.totalSeconds) << "\n";
+  llvm::outs() << "total reduction:       "
+               << reduction(defaultTimings.totalSeconds,
+                            extractTimings.totalSeconds)
+               << "\n";
+  bool identical = defaultTimings.outputDigest == extractTimings.outputDigest;
+  llvm::outs() << "output:                "
+               << (identical ? "identical" : "differs") << "\n";
+
+  if (!defaultTimings.success || !extractTimings.success) {
+    llvm::errs() << "te-bench: extraction failed\n";
+    return 1;
+  }
+  if (!identical) {
+    llvm::errs() << "te-bench: the extract profile changed the output\n";
+    return 1;
+  }
+  return 0;
+}
+
+// Include every header at the top of the sysroot's `usr/include`.
+static std::string makeCorpusHeader(llvm::StringRef sysroot) {
+  llvm::SmallString<256> includeDir(sysroot);
+  llvm::sys::path::append(includeDir, "usr", "include");
+  std::vector<std::string> headers;
+  std::error_code error;
+  for (llvm::sys::fs::directory_iterator it(includeDir, error), end;
+       it != end && !error; it.increment(error)) {
+    auto name = llvm::sys::path::filename(it->path());
+    if (name.ends_with(".h")) {
+      headers.push_back(name.str());
+    }
+  }
+  // Directory order isn't stable, and the include order affects the output.
+  llvm::sort(headers);
+  std::string code;
+  for (const auto &header : headers) {
+    code += "#include <" + header + ">\n";
+  }
+  return code;
+}
+
+static void printUsage() {
+  llvm::errs()
+      << "usage: te-bench json [--records <count>]\n"
+         "       te-bench synthetic [--structs <n>] [--fields <n>] "
+         "[--depth <n>] [--enums <n>] [--typedef-chains <n>] "
+         "[--typedef-chain-length <n>] [--functions <n>] "
+         "[--min-records-per-sec <n>] [--profile <profile>] "
+         "[--print-header]\n"
+         "       te-bench corpus <sysroot> [--min-records-per-sec <n>] "
+         "[--profile <profile>] [headers...] [-- clang args...]\n"
+         "\n"
+         "<profile> is default, extract, or compare (to run both).\n";
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (args.empty()) {
+    printUsage();
+    return 1;
+  }
+  auto mode = args.front();
+  args.erase(args.begin());
+
+  uint64_t recordCount = 1000000;
+  SyntheticHeaderOptions synthetic;
+  std::optional<std::string> sysroot;
+  std::vector<std::string> headers;
+  std::vector<std::string> clangArgs;
+  uint64_t minRecordsPerSecond = 0;
+  bool printHeader = false;
+  ExtractorOptions options;
+  bool compareProfiles = false;
+
+  // Every option takes a count, besides a few flags.
+  std::pair<llvm::StringRef, uint64_t *> countOptions[] = {
+      {"--records", &recordCount},
+      {"--min-records-per-sec", &minRecordsPerSecond},
+  };
+  std::pair<llvm::StringRef, unsigned *> shapeOptions[] = {
+      {"--structs", &synthetic.structs},
+      {"--fields", &synthetic.fields},
+      {"--depth", &synthetic.depth},
+      {"--enums", &synthetic.enums},
+      {"--typedef-chains", &synthetic.typedefChains},
+      {"--typedef-chain-length", &synthetic.typedefChainLength},
+      {"--functions", &synthetic.functions},
+  };
+  for (size_t i = 0; i < args.size(); ++i) {
+    llvm::StringRef arg = args[i];
+    bool hasValue = i + 1 < args.size();
+    auto parseCount = [&](auto *value) {
+      return hasValue && !llvm::StringRef(args[++i]).getAsInteger(10, *value);
+    };
+    auto countOption = llvm::find_if(
+        countOptions, [&](const auto &option) { return option.first == arg; });
+    auto shapeOption = llvm::find_if(
+        shapeOptions, [&](const auto &option) { return option.first == arg; });
+    if (countOption != std::end(countOptions)) {
+      if (!parseCount(countOption->second)) {
+        printUsage();
+        return 1;
+      }
+    } else if (mode == "synthetic" && shapeOption != std::end(shapeOptions)) {
+      if (!parseCount(shapeOption->second)) {
+        printUsage();
+        return 1;
+      }
+    } else if (mode != "json" && arg == "--profile" && hasValue) {
+      llvm::StringRef profile = args[++i];
+      if (profile == "default") {
+        options.frontendProfile = FrontendProfile::Default;
+      } else if (profile == "extract") {
+        options.frontendProfile = FrontendProfile::Extract;
+      } else if (profile == "compare") {
+        compareProfiles = true;
+      } else {
+        printUsage();
+        return 1;
+      }
+    } else if (mode == "synthetic" && arg == "--print-header") {
+      printHeader = true;
+    } else if (mode == "corpus" && arg == "--") {
+      clangArgs.assign(args.begin() + i + 1, args.end());
+      break;
+    } else if (mode == "corpus" && !arg.starts_with("-")) {
+      if (!sysroot) {
+        sysroot = arg.str();
+      } else {
+        headers.push_back(arg.str());
+      }
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (mode == "json") {
+    return runJSONBenchmark(recordCount);
+  }
+  if (mode == "synthetic") {
+    auto code = generateSyntheticHeader(synthetic);
+    if (printHeader) {
+      llvm::outs() << code;
+      return 0;
+    }
+    if (compareProfiles) {
+      return runProfileComparison(code, {});
+    }
+    return runExtractionBenchmark(code, {}, options, minRecordsPerSecond);
+  }
+  if (mode == "corpus" && sysroot) {
+    std::string code;
+    if (headers.empty()) {
+      code = makeCorpusHeader(*sysroot);
+    }
+    for (const auto &header : headers) {
+      code += "#include <" + header + ">\n";
+    }
+    std::vector<std::string> corpusArgs = {"-isysroot", *sysroot};
+    corpusArgs.insert(corpusArgs.end(), clangArgs.begin(), clangArgs.end());
+    if (compareProfiles) {
+      return runProfileComparison(code, corpusArgs);
+    }
+    return runExtractionBenchmark(code, corpusArgs, options,
+                                  minRecordsPerSecond);
+  }
+  printUsage();
+  return 1;
+}
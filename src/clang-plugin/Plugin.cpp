@@ -2,6 +2,7 @@
 #include <clang/AST/ASTConsumer.h>
 #include <clang/Frontend/FrontendAction.h>
 #include <clang/Frontend/FrontendPluginRegistry.h>
+#include <llvm/Support/raw_ostream.h>
 
 class FooConsumer : public clang::ASTConsumer {};
 
@@ -16,8 +17,29 @@ public:
                     llvm::StringRef file) override {
     return TypeExtractorAction::CreateASTConsumer(CI, file);
   }
+  // Given as `-plugin-arg-type-extractor <arg>`. Time-trace events of the
+  //  extraction show up in Clang's own `-ftime-trace` output. Within a
+  //  build, `out-dir=` and `dedup-store=` let every compiler write its own
+  //  share of the types, for `te merge` to combine.
   bool ParseArgs(const clang::CompilerInstance &CI,
                  const std::vector<std::string> &args) override {
+    for (llvm::StringRef arg : args) {
+      if (arg == "stats") {
+        getOptions().collectStats = true;
+      } else if (arg.consume_front("out-dir=")) {
+        getOptions().outputDirectory = arg.str();
+      } else if (arg.consume_front("dedup-store=")) {
+        getOptions().dedupStorePath = arg.str();
+      } else if (arg.consume_front("serialize-threads=")) {
+        if (arg.getAsInteger(10, getOptions().serializationThreads)) {
+          llvm::errs() << "te: invalid thread count: " << arg << "\n";
+          return false;
+        }
+      } else {
+        llvm::errs() << "te: unknown plugin argument: " << arg << "\n";
+        return false;
+      }
+    }
     return true;
   }
 };
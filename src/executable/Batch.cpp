@@ -0,0 +1,234 @@
+#include "Batch.h"
+#include "HeaderArchive.h"
+#include "Options.h"
+#include "TypeExtractorAction.h"
+#include <atomic>
+#include <clang/Basic/FileManager.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+#include <optional>
+
+namespace {
+
+// One translation unit to extract.
+struct BatchJob {
+  std::string file;
+  std::string directory;
+  std::vector<std::string> commandLine;
+};
+
+// A copy of an `EmittedRecord` that outlives the translation unit.
+struct BatchRecord {
+  std::string declID;
+  bool isDefinition;
+  std::string json;
+};
+
+// Merges per-TU records into one stream, in input order, keeping the first
+//  definition for each stable ID. A forward declaration is written where
+//  it's first seen (unless the definition already was), so that it still
+//  comes before the records referencing it. A later definition follows it.
+class RecordMerger {
+private:
+  std::mutex Mutex;
+  // IDs whose definition has been written.
+  llvm::StringSet<> Emitted;
+  // IDs that only a forward declaration has been written for.
+  llvm::StringSet<> Declared;
+  std::vector<std::optional<std::vector<BatchRecord>>> Results;
+  size_t NextResult = 0;
+
+  void merge(const std::vector<BatchRecord> &records) {
+    for (const auto &record : records) {
+      if (Emitted.contains(record.declID)) {
+        continue; // Another TU already emitted this type.
+      }
+      if (record.isDefinition) {
+        Emitted.insert(record.declID);
+      } else if (!Declared.insert(record.declID).second) {
+        continue;
+      }
+      llvm::outs() << record.json << "\n";
+    }
+  }
+
+public:
+  explicit RecordMerger(size_t jobCount) : Results(jobCount) {}
+
+  // Whether a definitive record with this ID has already been written.
+  bool isEmitted(llvm::StringRef declID) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Emitted.contains(declID);
+  }
+
+  // Hand over the records of job `index`, writing out every job whose
+  //  predecessors have all completed.
+  void complete(size_t index, std::vector<BatchRecord> records) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Results[index] = std::move(records);
+    while (NextResult < Results.size() && Results[NextResult]) {
+      merge(*Results[NextResult]);
+      Results[NextResult]->clear();
+      Results[NextResult]->shrink_to_fit();
+      NextResult++;
+    }
+  }
+
+  void finish() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    llvm::outs().flush();
+  }
+};
+
+bool runJob(const BatchJob &job, const ExtractorOptions &options,
+            const std::shared_ptr<const HeaderArchive> &archive,
+            RecordMerger &merger, std::vector<BatchRecord> &records) {
+  // Each job gets its own file system view (for the working directory) and
+  //  file manager, as neither is safe to share between threads. The archive
+  //  itself is only read, so it's shared.
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> fileSystem(
+      llvm::vfs::createPhysicalFileSystem().release());
+  if (archive) {
+    fileSystem = createHeaderArchiveFileSystem(archive, fileSystem);
+  }
+  if (!job.directory.empty()) {
+    fileSystem->setCurrentWorkingDirectory(job.directory);
+  }
+  llvm::IntrusiveRefCntPtr<clang::FileManager> files(
+      new clang::FileManager(clang::FileSystemOptions(), fileSystem));
+
+  auto action = std::make_unique<TypeExtractorAction>(
+      [&](const EmittedRecord &record) {
+        // Skip copying records the merged stream already has (including
+        //  forward declarations, which a definition makes redundant).
+        if (merger.isEmitted(record.declID)) {
+          return;
+        }
+        records.push_back(
+            {record.declID.str(), record.isDefinition, record.json.str()});
+      },
+      options);
+  clang::tooling::ToolInvocation invocation(job.commandLine, std::move(action),
+                                            files.get());
+  return invocation.run();
+}
+
+void printUsage() {
+  llvm::errs() << "usage: te batch [-j <jobs>] [--compile-commands <file>] "
+                  "[--include=<glob>] [--exclude=<glob>] "
+                  "[--include-root=<root>] [--exclude-root=<root>] "
+                  "[--root=<name>] [--roots-file=<file>] [--stats] "
+                  "[--header-archive=<file>] [headers...] [-- clang args...]\n";
+}
+
+} // namespace
+
+int runBatch(const std::vector<std::string> &args) {
+  unsigned threadCount = 0; // Zero means one thread per hardware thread.
+  std::optional<std::string> compileCommandsPath;
+  std::shared_ptr<const HeaderArchive> archive;
+  std::vector<std::string> headers;
+  std::vector<std::string> clangArgs;
+  ExtractorOptions options;
+  bool badOption = false;
+
+  // Parse options, with everything after "--" going to Clang.
+  for (size_t i = 0; i < args.size(); ++i) {
+    llvm::StringRef arg = args[i];
+    if (arg == "--") {
+      clangArgs.assign(args.begin() + i + 1, args.end());
+      break;
+    } else if (arg == "-j" && i + 1 < args.size()) {
+      if (llvm::StringRef(args[++i]).getAsInteger(10, threadCount)) {
+        printUsage();
+        return 1;
+      }
+    } else if (arg == "--compile-commands" && i + 1 < args.size()) {
+      compileCommandsPath = args[++i];
+    } else if (arg.consume_front("--header-archive=")) {
+      archive = HeaderArchive::open(arg);
+      if (!archive) {
+        llvm::errs() << "te: " << arg << " is not a valid header archive\n";
+        return 1;
+      }
+    } else if (consumeExtractorOption(arg, options, badOption)) {
+      if (badOption) {
+        return 1;
+      }
+    } else if (arg.starts_with("-")) {
+      printUsage();
+      return 1;
+    } else {
+      headers.push_back(arg.str());
+    }
+  }
+
+  std::vector<BatchJob> jobs;
+  llvm::SmallString<256> currentDirectory;
+  llvm::sys::fs::current_path(currentDirectory);
+
+  if (compileCommandsPath) {
+    std::string error;
+    auto database = clang::tooling::JSONCompilationDatabase::loadFromFile(
+        *compileCommandsPath, error,
+        clang::tooling::JSONCommandLineSyntax::AutoDetect);
+    if (!database) {
+      llvm::errs() << "te: " << error << "\n";
+      return 1;
+    }
+    // Only parse, and never write objects or dependency files.
+    auto adjuster = clang::tooling::combineAdjusters(
+        clang::tooling::combineAdjusters(
+            clang::tooling::getClangSyntaxOnlyAdjuster(),
+            clang::tooling::getClangStripOutputAdjuster()),
+        clang::tooling::combineAdjusters(
+            clang::tooling::getClangStripDependencyFileAdjuster(),
+            clang::tooling::getInsertArgumentAdjuster(
+                clangArgs, clang::tooling::ArgumentInsertPosition::END)));
+    for (const auto &command : database->getAllCompileCommands()) {
+      jobs.push_back({command.Filename, command.Directory,
+                      adjuster(command.CommandLine, command.Filename)});
+    }
+  }
+
+  for (const auto &header : headers) {
+    llvm::SmallString<256> absolutePath(header);
+    llvm::sys::fs::make_absolute(absolutePath);
+    std::vector<std::string> commandLine = {"clang-tool", "-fsyntax-only"};
+    commandLine.insert(commandLine.end(), clangArgs.begin(), clangArgs.end());
+    commandLine.push_back(absolutePath.str().str());
+    jobs.push_back({absolutePath.str().str(), currentDirectory.str().str(),
+                    std::move(commandLine)});
+  }
+
+  if (jobs.empty()) {
+    printUsage();
+    return 1;
+  }
+
+  RecordMerger merger(jobs.size());
+  std::atomic<bool> failed = false;
+  llvm::DefaultThreadPool pool(llvm::hardware_concurrency(threadCount));
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    pool.async([&, i] {
+      std::vector<BatchRecord> records;
+      if (!runJob(jobs[i], options, archive, merger, records)) {
+        failed = true;
+      }
+      merger.complete(i, std::move(records));
+    });
+  }
+  pool.wait();
+  merger.finish();
+
+  return failed ? 1 : 0;
+}
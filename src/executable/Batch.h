@@ -0,0 +1,12 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_BATCH_H
+#define TYPE_EXTRACTOR_BATCH_H
+
+// Run `te batch [options] [headers...] [-- clang args...]`, extracting many
+//  translation units on a worker pool and merging their records into a
+//  single deduplicated stream on stdout.
+int runBatch(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_BATCH_H
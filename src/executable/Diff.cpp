@@ -0,0 +1,176 @@
+#include "Diff.h"
+#include "Options.h"
+#include "TypeExtractorAction.h"
+#include <clang/Tooling/Tooling.h>
+#include <iostream>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <sstream>
+
+namespace {
+
+// A record of one side of the diff, as written by the default format.
+struct DiffRecord {
+  std::string line;
+  std::string declID;
+  std::string hash;
+  llvm::json::Value type = nullptr;
+  llvm::json::Value properties = nullptr;
+};
+
+// Parse the records of one side, in order. Errors are printed.
+bool parseRecords(llvm::StringRef name, llvm::ArrayRef<std::string> lines,
+                  std::vector<DiffRecord> &records) {
+  for (const auto &line : lines) {
+    if (llvm::StringRef(line).trim().empty()) {
+      continue;
+    }
+    auto value = llvm::json::parse(line);
+    if (!value) {
+      llvm::errs() << "te: " << name << ": "
+                   << llvm::toString(value.takeError()) << "\n";
+      return false;
+    }
+    auto object = value->getAsObject();
+    auto type = object ? object->getObject("type") : nullptr;
+    auto declID = type ? type->getString("declID") : std::nullopt;
+    auto hash = object ? object->getString("hash") : std::nullopt;
+    if (!declID || !hash) {
+      llvm::errs() << "te: " << name
+                   << ": expected records of the default format, with hashes\n";
+      return false;
+    }
+    records.push_back({line, declID->str(), hash->str(), *object->get("type"),
+                       object->get("properties") ? *object->get("properties")
+                                                 : nullptr});
+  }
+  return true;
+}
+
+std::vector<std::string> splitLines(llvm::StringRef contents) {
+  std::vector<std::string> lines;
+  while (!contents.empty()) {
+    llvm::StringRef line;
+    std::tie(line, contents) = contents.split('\n');
+    lines.push_back(line.str());
+  }
+  return lines;
+}
+
+// Read the records of an output file. Errors are printed.
+bool readRecords(llvm::StringRef path, std::vector<DiffRecord> &records) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    llvm::errs() << "te: can't read " << path << ": "
+                 << buffer.getError().message() << "\n";
+    return false;
+  }
+  return parseRecords(path, splitLines((*buffer)->getBuffer()), records);
+}
+
+// Extract the code from stdin, like the default command. Errors are printed.
+bool extractRecords(const std::vector<std::string> &args,
+                    std::vector<DiffRecord> &records) {
+  ExtractorOptions options;
+  bool badOption = false;
+  size_t argIndex = 0;
+  while (argIndex < args.size() &&
+         consumeExtractorOption(args[argIndex], options, badOption)) {
+    ++argIndex;
+  }
+  if (badOption) {
+    return false;
+  }
+  std::vector<std::string> clangArgs(args.begin() + argIndex, args.end());
+
+  // Take code from standard input
+  std::string code =
+      std::string((std::stringstream() << std::cin.rdbuf()).str());
+
+  std::vector<std::string> lines;
+  bool success = clang::tooling::runToolOnCodeWithArgs(
+      std::make_unique<TypeExtractorAction>(
+          [&](const EmittedRecord &record) {
+            lines.push_back(record.json.str());
+          },
+          options),
+      code, clangArgs, "header.h");
+  if (!success) {
+    llvm::errs() << "te: extraction failed\n";
+    return false;
+  }
+  return parseRecords("<stdin>", lines, records);
+}
+
+// Write the record with a "change" attribute in front of its own.
+void writeChange(llvm::raw_ostream &OS, llvm::StringRef change,
+                 const DiffRecord &record) {
+  OS << "{\"change\":\"" << change << "\","
+     << llvm::StringRef(record.line).trim().drop_front() << "\n";
+}
+
+void printUsage() {
+  llvm::errs() << "usage: te diff <old output> <new output>\n"
+                  "       te diff <old output> - [options] [args...]\n";
+}
+
+} // namespace
+
+int runDiff(const std::vector<std::string> &args) {
+  if (args.size() < 2 || (args[1] != "-" && args.size() != 2)) {
+    printUsage();
+    return 1;
+  }
+
+  std::vector<DiffRecord> oldRecords;
+  std::vector<DiffRecord> newRecords;
+  if (!readRecords(args[0], oldRecords)) {
+    return 1;
+  }
+  if (args[1] == "-") {
+    if (!extractRecords(std::vector<std::string>(args.begin() + 2, args.end()),
+                        newRecords)) {
+      return 1;
+    }
+  } else if (!readRecords(args[1], newRecords)) {
+    return 1;
+  }
+
+  llvm::StringMap<const DiffRecord *> oldByID;
+  for (const auto &record : oldRecords) {
+    oldByID[record.declID] = &record;
+  }
+  llvm::StringMap<const DiffRecord *> newByID;
+  for (const auto &record : newRecords) {
+    newByID[record.declID] = &record;
+  }
+
+  // Removals come first, then everything else in the order of the new side,
+  //  so the types a record references still come before it.
+  auto &OS = llvm::outs();
+  for (const auto &record : oldRecords) {
+    if (!newByID.contains(record.declID)) {
+      writeChange(OS, "removed", record);
+    }
+  }
+  for (const auto &record : newRecords) {
+    auto it = oldByID.find(record.declID);
+    if (it == oldByID.end()) {
+      writeChange(OS, "added", record);
+      continue;
+    }
+    const auto &old = *it->second;
+    if (old.hash == record.hash) {
+      continue;
+    }
+    // As hashes cover the types a record references, a record whose own
+    //  properties are the same only changed through one of those.
+    bool sameProperties =
+        old.type == record.type && old.properties == record.properties;
+    writeChange(OS, sameProperties ? "dependent" : "changed", record);
+  }
+  OS.flush();
+  return 0;
+}
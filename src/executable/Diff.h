@@ -0,0 +1,12 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_DIFF_H
+#define TYPE_EXTRACTOR_DIFF_H
+
+// Run `te diff <old> <new>` (or `te diff <old> - [options] [args...]`, to
+//  extract the code from stdin as the new side), writing the records that
+//  were added, removed or changed in between.
+int runDiff(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_DIFF_H
@@ -0,0 +1,21 @@
+#include "DumpBinary.h"
+#include "BinaryReader.h"
+#include <llvm/Support/raw_ostream.h>
+
+int runDumpBinary(const std::vector<std::string> &args) {
+  if (args.size() != 1) {
+    llvm::errs() << "usage: te dump-binary <file>\n";
+    return 1;
+  }
+  auto file = BinaryTypeFile::open(args.front().c_str());
+  if (!file) {
+    llvm::errs() << "te: " << args.front() << " is not a valid binary file\n";
+    return 1;
+  }
+
+  for (const auto view : *file) {
+    writeTypeRecordJSON(llvm::outs(), readBinaryRecord(*file, view));
+    llvm::outs() << "\n";
+  }
+  return 0;
+}
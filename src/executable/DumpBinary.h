@@ -0,0 +1,11 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_DUMP_BINARY_H
+#define TYPE_EXTRACTOR_DUMP_BINARY_H
+
+// Run `te dump-binary <file>`, printing the records of a binary output file
+//  as the JSON lines the default output format would have.
+int runDumpBinary(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_DUMP_BINARY_H
@@ -0,0 +1,539 @@
+#include "HeaderArchive.h"
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <unistd.h>
+
+// Symlinks are followed up to the same depth as on Linux.
+static constexpr unsigned maxSymlinkDepth = 40;
+
+bool HeaderArchive::validate() {
+  const char *data = Buffer->getBufferStart();
+  uint64_t size = Buffer->getBufferSize();
+  if (size < sizeof(HeaderArchiveHeader) ||
+      reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+    return false;
+  }
+  Header = reinterpret_cast<const HeaderArchiveHeader *>(data);
+  if (std::memcmp(Header->magic, headerArchiveMagic,
+                  sizeof(headerArchiveMagic)) != 0 ||
+      Header->version != headerArchiveVersion) {
+    return false;
+  }
+  if (Header->entriesOffset % 8 != 0 || Header->entriesOffset > size ||
+      Header->entryCount > (size - Header->entriesOffset) /
+                               sizeof(HeaderArchiveEntry) ||
+      Header->stringTableOffset > size ||
+      Header->stringTableSize > size - Header->stringTableOffset) {
+    return false;
+  }
+  // With a NUL at the end of the string table, every string is terminated.
+  if (Header->stringTableSize == 0 ||
+      data[Header->stringTableOffset + Header->stringTableSize - 1] != '\0' ||
+      Header->mountPoint >= Header->stringTableSize) {
+    return false;
+  }
+  Entries = {reinterpret_cast<const HeaderArchiveEntry *>(
+                 data + Header->entriesOffset),
+             Header->entryCount};
+
+  for (size_t i = 0; i < Entries.size(); ++i) {
+    const auto &entry = Entries[i];
+    if (entry.path >= Header->stringTableSize ||
+        entry.kind > uint32_t(HeaderArchiveEntryKind::Symlink)) {
+      return false;
+    }
+    // Lookups rely on the entries being sorted.
+    if (i > 0 && !(getPath(Entries[i - 1]) < getPath(entry))) {
+      return false;
+    }
+    if (HeaderArchiveEntryKind(entry.kind) ==
+        HeaderArchiveEntryKind::Directory) {
+      continue;
+    }
+    // File data and symlink targets are followed by a NUL.
+    if (entry.dataOffset > size || entry.dataSize >= size - entry.dataOffset ||
+        data[entry.dataOffset + entry.dataSize] != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+llvm::StringRef HeaderArchive::string(uint32_t offset) const {
+  if (offset >= Header->stringTableSize) {
+    return {};
+  }
+  return Buffer->getBufferStart() + Header->stringTableOffset + offset;
+}
+
+std::unique_ptr<HeaderArchive> HeaderArchive::open(llvm::StringRef path) {
+  // Large files are mapped rather than read.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    return nullptr;
+  }
+  std::unique_ptr<HeaderArchive> archive(new HeaderArchive());
+  archive->Buffer = std::move(*buffer);
+  if (!archive->validate()) {
+    return nullptr;
+  }
+  return archive;
+}
+
+llvm::StringRef HeaderArchive::getData(const HeaderArchiveEntry &entry) const {
+  if (HeaderArchiveEntryKind(entry.kind) == HeaderArchiveEntryKind::Directory) {
+    return {};
+  }
+  return {Buffer->getBufferStart() + entry.dataOffset, entry.dataSize};
+}
+
+std::optional<size_t> HeaderArchive::lookup(llvm::StringRef path) const {
+  auto it = llvm::partition_point(Entries, [&](const HeaderArchiveEntry &e) {
+    return getPath(e) < path;
+  });
+  if (it == Entries.end() || getPath(*it) != path) {
+    return std::nullopt;
+  }
+  return it - Entries.begin();
+}
+
+std::optional<size_t> HeaderArchive::resolve(llvm::StringRef path) const {
+  llvm::SmallString<256> current(path);
+  for (unsigned depth = 0; depth <= maxSymlinkDepth; ++depth) {
+    // Look up each leading part of the path in turn, as any of them may be a
+    //  symlink.
+    size_t end = current.str().find('/');
+    while (true) {
+      llvm::StringRef prefix = current.str().substr(0, end);
+      auto index = lookup(prefix);
+      if (!index) {
+        return std::nullopt;
+      }
+      auto kind = HeaderArchiveEntryKind(Entries[*index].kind);
+      if (kind == HeaderArchiveEntryKind::Symlink) {
+        break;
+      }
+      if (end == llvm::StringRef::npos) {
+        return index;
+      }
+      if (kind != HeaderArchiveEntryKind::Directory) {
+        return std::nullopt;
+      }
+      end = current.str().find('/', end + 1);
+    }
+
+    // Replace the symlink with its target, which must be in the archive.
+    llvm::StringRef prefix = current.str().substr(0, end);
+    llvm::StringRef target = getData(Entries[*lookup(prefix)]);
+    llvm::SmallString<256> next;
+    if (llvm::sys::path::is_absolute(target)) {
+      if (!target.consume_front(getMountPoint()) ||
+          (!target.empty() && !target.consume_front("/"))) {
+        return std::nullopt;
+      }
+      next = target;
+    } else {
+      next = llvm::sys::path::parent_path(prefix);
+      llvm::sys::path::append(next, target);
+    }
+    if (end != llvm::StringRef::npos) {
+      llvm::sys::path::append(next, current.str().substr(end + 1));
+    }
+    // A leading ".." that's left points outside of the archive, and is never
+    //  found.
+    llvm::sys::path::remove_dots(next, /*remove_dot_dot=*/true);
+    current = next;
+  }
+  return std::nullopt;
+}
+
+namespace {
+
+// A file whose contents are in the archive.
+class ArchiveFile : public llvm::vfs::File {
+private:
+  llvm::vfs::Status Status;
+  llvm::StringRef Data;
+
+public:
+  ArchiveFile(llvm::vfs::Status status, llvm::StringRef data)
+      : Status(std::move(status)), Data(data) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status() override { return Status; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const llvm::Twine &name, int64_t fileSize,
+            bool requiresNullTerminator, bool isVolatile) override {
+    return llvm::MemoryBuffer::getMemBuffer(Data, name.str(),
+                                            requiresNullTerminator);
+  }
+
+  std::error_code close() override { return {}; }
+};
+
+class ArchiveDirIterImpl : public llvm::vfs::detail::DirIterImpl {
+private:
+  std::vector<llvm::vfs::directory_entry> Entries;
+  size_t NextEntry = 0;
+
+public:
+  explicit ArchiveDirIterImpl(std::vector<llvm::vfs::directory_entry> entries)
+      : Entries(std::move(entries)) {
+    increment();
+  }
+
+  std::error_code increment() override {
+    CurrentEntry = NextEntry < Entries.size() ? Entries[NextEntry++]
+                                              : llvm::vfs::directory_entry();
+    return {};
+  }
+};
+
+class HeaderArchiveFileSystem : public llvm::vfs::ProxyFileSystem {
+private:
+  // Unlike the device of virtual files (the maximum), and of real ones.
+  static constexpr uint64_t archiveDevice =
+      std::numeric_limits<uint64_t>::max() - 1;
+
+  std::shared_ptr<const HeaderArchive> Archive;
+
+  // The path relative to the mount point, if `path` is under it. `storage`
+  //  is left holding the absolute path, without any "." or "..".
+  std::optional<llvm::StringRef>
+  getArchivePath(const llvm::Twine &path,
+                 llvm::SmallVectorImpl<char> &storage) const {
+    path.toVector(storage);
+    if (makeAbsolute(storage)) {
+      return std::nullopt;
+    }
+    llvm::sys::path::remove_dots(storage, /*remove_dot_dot=*/true);
+    llvm::StringRef archivePath(storage.data(), storage.size());
+    if (!archivePath.consume_front(Archive->getMountPoint()) ||
+        (!archivePath.empty() && !archivePath.consume_front("/"))) {
+      return std::nullopt;
+    }
+    return archivePath;
+  }
+
+  llvm::vfs::Status makeStatus(llvm::StringRef name, size_t index) const {
+    const auto &entry = Archive->entries()[index];
+    bool isDirectory = HeaderArchiveEntryKind(entry.kind) ==
+                       HeaderArchiveEntryKind::Directory;
+    return llvm::vfs::Status(
+        name, llvm::sys::fs::UniqueID(archiveDevice, index),
+        llvm::sys::toTimePoint(entry.modificationTime), 0, 0,
+        isDirectory ? 0 : entry.dataSize,
+        isDirectory ? llvm::sys::fs::file_type::directory_file
+                    : llvm::sys::fs::file_type::regular_file,
+        isDirectory ? llvm::sys::fs::perms(llvm::sys::fs::all_read |
+                                           llvm::sys::fs::all_exe)
+                    : llvm::sys::fs::all_read);
+  }
+
+public:
+  HeaderArchiveFileSystem(std::shared_ptr<const HeaderArchive> archive,
+                          llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+      : ProxyFileSystem(std::move(FS)), Archive(std::move(archive)) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &path) override {
+    llvm::SmallString<256> storage;
+    auto archivePath = getArchivePath(path, storage);
+    if (!archivePath) {
+      return getUnderlyingFS().status(path);
+    }
+    auto index = Archive->resolve(*archivePath);
+    if (!index) {
+      return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+    return makeStatus(storage, *index);
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &path) override {
+    llvm::SmallString<256> storage;
+    auto archivePath = getArchivePath(path, storage);
+    if (!archivePath) {
+      return getUnderlyingFS().openFileForRead(path);
+    }
+    auto index = Archive->resolve(*archivePath);
+    if (!index) {
+      return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+    const auto &entry = Archive->entries()[*index];
+    if (HeaderArchiveEntryKind(entry.kind) != HeaderArchiveEntryKind::File) {
+      return std::make_error_code(std::errc::is_a_directory);
+    }
+    return std::make_unique<ArchiveFile>(makeStatus(storage, *index),
+                                         Archive->getData(entry));
+  }
+
+  llvm::vfs::directory_iterator dir_begin(const llvm::Twine &dir,
+                                          std::error_code &EC) override {
+    llvm::SmallString<256> storage;
+    auto archivePath = getArchivePath(dir, storage);
+    if (!archivePath) {
+      return getUnderlyingFS().dir_begin(dir, EC);
+    }
+    auto index = Archive->resolve(*archivePath);
+    if (!index) {
+      EC = std::make_error_code(std::errc::no_such_file_or_directory);
+      return {};
+    }
+    const auto &directory = Archive->entries()[*index];
+    if (HeaderArchiveEntryKind(directory.kind) !=
+        HeaderArchiveEntryKind::Directory) {
+      EC = std::make_error_code(std::errc::not_a_directory);
+      return {};
+    }
+
+    // The children are among the entries starting with "<directory>/", which
+    //  are next to each other as they're sorted. They don't necessarily
+    //  follow the directory itself, since a sibling like "include-fixed"
+    //  sorts between "include" and "include/...".
+    llvm::SmallString<256> prefix(Archive->getPath(directory));
+    if (!prefix.empty()) {
+      prefix += '/';
+    }
+    auto first = llvm::partition_point(
+        Archive->entries(), [&](const HeaderArchiveEntry &entry) {
+          return Archive->getPath(entry) < prefix;
+        });
+    std::vector<llvm::vfs::directory_entry> children;
+    for (const auto &entry :
+         llvm::make_range(first, Archive->entries().end())) {
+      llvm::StringRef name = Archive->getPath(entry);
+      if (!name.consume_front(prefix)) {
+        break;
+      }
+      if (name.empty()) {
+        continue; // The root itself.
+      }
+      if (name.contains('/')) {
+        continue; // Further down.
+      }
+      llvm::SmallString<256> childPath(storage);
+      llvm::sys::path::append(childPath, name);
+      llvm::sys::fs::file_type type;
+      switch (HeaderArchiveEntryKind(entry.kind)) {
+      case HeaderArchiveEntryKind::Directory:
+        type = llvm::sys::fs::file_type::directory_file;
+        break;
+      case HeaderArchiveEntryKind::File:
+        type = llvm::sys::fs::file_type::regular_file;
+        break;
+      case HeaderArchiveEntryKind::Symlink:
+        type = llvm::sys::fs::file_type::symlink_file;
+        break;
+      }
+      children.emplace_back(childPath.str().str(), type);
+    }
+    EC = {};
+    return llvm::vfs::directory_iterator(
+        std::make_shared<ArchiveDirIterImpl>(std::move(children)));
+  }
+
+};
+
+// An entry to be packed.
+struct PackEntry {
+  std::string path;
+  std::string absolutePath;
+  HeaderArchiveEntryKind kind;
+  int64_t modificationTime;
+  uint64_t size = 0;
+  std::string symlinkTarget = {};
+};
+
+// Add the entry for `absolutePath`, skipping anything that isn't a directory,
+//  a file or a symlink. Returns false on errors, which are printed.
+bool addPackEntry(std::vector<PackEntry> &entries,
+                  llvm::StringRef absolutePath, llvm::StringRef path) {
+  llvm::sys::fs::file_status status;
+  if (auto error =
+          llvm::sys::fs::status(absolutePath, status, /*Follow=*/false)) {
+    llvm::errs() << "te: can't stat " << absolutePath << ": "
+                 << error.message() << "\n";
+    return false;
+  }
+  PackEntry entry = {path.str(), absolutePath.str(),
+                     HeaderArchiveEntryKind::Directory,
+                     llvm::sys::toTimeT(status.getLastModificationTime())};
+  switch (status.type()) {
+  case llvm::sys::fs::file_type::directory_file:
+    break;
+  case llvm::sys::fs::file_type::regular_file:
+    entry.kind = HeaderArchiveEntryKind::File;
+    entry.size = status.getSize();
+    break;
+  case llvm::sys::fs::file_type::symlink_file: {
+    char target[PATH_MAX];
+    ssize_t length = ::readlink(entry.absolutePath.c_str(), target,
+                                sizeof(target));
+    if (length < 0) {
+      llvm::errs() << "te: can't read the symlink " << absolutePath << "\n";
+      return false;
+    }
+    entry.kind = HeaderArchiveEntryKind::Symlink;
+    entry.symlinkTarget.assign(target, size_t(length));
+    entry.size = entry.symlinkTarget.size();
+    break;
+  }
+  default:
+    return true; // Sockets, pipes and the like aren't headers.
+  }
+  entries.push_back(std::move(entry));
+  return true;
+}
+
+void printPackUsage() {
+  llvm::errs() << "usage: te pack [--mount=<path>] <directory> <archive>\n";
+}
+
+} // namespace
+
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> createHeaderArchiveFileSystem(
+    std::shared_ptr<const HeaderArchive> archive,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> underlying) {
+  return llvm::makeIntrusiveRefCnt<HeaderArchiveFileSystem>(
+      std::move(archive), std::move(underlying));
+}
+
+int runPack(const std::vector<std::string> &args) {
+  std::optional<std::string> mountPoint;
+  std::vector<std::string> paths;
+  for (const auto &argString : args) {
+    llvm::StringRef arg = argString;
+    if (arg.consume_front("--mount=")) {
+      mountPoint = arg.str();
+    } else if (arg.starts_with("-")) {
+      printPackUsage();
+      return 1;
+    } else {
+      paths.push_back(arg.str());
+    }
+  }
+  if (paths.size() != 2) {
+    printPackUsage();
+    return 1;
+  }
+
+  llvm::SmallString<256> root(paths[0]);
+  llvm::sys::fs::make_absolute(root);
+  llvm::sys::path::remove_dots(root, /*remove_dot_dot=*/true);
+  if (!llvm::sys::fs::is_directory(root)) {
+    llvm::errs() << "te: " << paths[0] << " is not a directory\n";
+    return 1;
+  }
+  // By default, the tree shows up where it was packed from.
+  llvm::SmallString<256> mount(mountPoint ? *mountPoint : root.str());
+  if (!llvm::sys::path::is_absolute(mount)) {
+    llvm::errs() << "te: the mount point must be an absolute path\n";
+    return 1;
+  }
+  llvm::sys::path::remove_dots(mount, /*remove_dot_dot=*/true);
+
+  // Symlinks are packed as they are, rather than followed.
+  std::vector<PackEntry> entries;
+  if (!addPackEntry(entries, root, "")) {
+    return 1;
+  }
+  std::error_code error;
+  for (llvm::sys::fs::recursive_directory_iterator
+           it(root, error, /*follow_symlinks=*/false),
+       end;
+       it != end && !error; it.increment(error)) {
+    llvm::StringRef path = it->path();
+    path = path.drop_front(root.size());
+    path.consume_front("/");
+    if (!addPackEntry(entries, it->path(), path)) {
+      return 1;
+    }
+  }
+  if (error) {
+    llvm::errs() << "te: can't read " << root << ": " << error.message()
+                 << "\n";
+    return 1;
+  }
+  llvm::sort(entries, [](const PackEntry &a, const PackEntry &b) {
+    return llvm::StringRef(a.path) < llvm::StringRef(b.path);
+  });
+
+  // Lay out the string table and data.
+  std::string strings;
+  auto addString = [&](llvm::StringRef string) {
+    uint64_t offset = strings.size();
+    strings += string;
+    strings += '\0';
+    return offset;
+  };
+  HeaderArchiveHeader header = {};
+  std::memcpy(header.magic, headerArchiveMagic, sizeof(headerArchiveMagic));
+  header.version = headerArchiveVersion;
+  header.entryCount = uint32_t(entries.size());
+  header.entriesOffset = sizeof(HeaderArchiveHeader);
+  header.stringTableOffset =
+      header.entriesOffset + entries.size() * sizeof(HeaderArchiveEntry);
+  header.mountPoint = uint32_t(addString(mount));
+  std::vector<HeaderArchiveEntry> packedEntries;
+  for (const auto &entry : entries) {
+    packedEntries.push_back({uint32_t(addString(entry.path)),
+                             uint32_t(entry.kind), entry.modificationTime, 0,
+                             entry.size});
+  }
+  if (strings.size() > UINT32_MAX || entries.size() > UINT32_MAX) {
+    llvm::errs() << "te: too many files to pack\n";
+    return 1;
+  }
+  header.stringTableSize = strings.size();
+  uint64_t dataOffset = header.stringTableOffset + header.stringTableSize;
+  for (auto &entry : packedEntries) {
+    if (HeaderArchiveEntryKind(entry.kind) !=
+        HeaderArchiveEntryKind::Directory) {
+      entry.dataOffset = dataOffset;
+      dataOffset += entry.dataSize + 1;
+    }
+  }
+
+  llvm::raw_fd_ostream OS(paths[1], error);
+  if (error) {
+    llvm::errs() << "te: can't write " << paths[1] << ": " << error.message()
+                 << "\n";
+    return 1;
+  }
+  OS.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  OS.write(reinterpret_cast<const char *>(packedEntries.data()),
+           packedEntries.size() * sizeof(HeaderArchiveEntry));
+  OS << strings;
+  // Files are read one at a time, so the tree never has to fit in memory.
+  for (const auto &entry : entries) {
+    if (entry.kind == HeaderArchiveEntryKind::Symlink) {
+      OS << entry.symlinkTarget << '\0';
+    } else if (entry.kind == HeaderArchiveEntryKind::File) {
+      auto buffer = llvm::MemoryBuffer::getFile(
+          entry.absolutePath, /*IsText=*/false,
+          /*RequiresNullTerminator=*/false);
+      if (!buffer || (*buffer)->getBufferSize() != entry.size) {
+        llvm::errs() << "te: " << entry.absolutePath
+                     << " couldn't be read, or changed while packing\n";
+        return 1;
+      }
+      OS << (*buffer)->getBuffer() << '\0';
+    }
+  }
+  OS.close();
+  if (OS.has_error()) {
+    llvm::errs() << "te: can't write " << paths[1] << ": "
+                 << OS.error().message() << "\n";
+    OS.clear_error();
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <cstdint>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_HEADER_ARCHIVE_H
+#define TYPE_EXTRACTOR_HEADER_ARCHIVE_H
+
+// A packed header archive holds a directory tree (usually an SDK) in one
+//  file, so that it can be mapped once instead of searched and read file by
+//  file. A file is laid out as:
+//
+//   HeaderArchiveHeader
+//   the entries, sorted by path
+//   the string table, of NUL-terminated strings
+//   the data of the files and symlinks, each followed by a NUL
+//
+// Paths are relative to the mount point (the root entry's path is empty),
+//  which is where the tree shows up in the file system. Values are in the
+//  byte order of the machine that wrote the file.
+
+inline constexpr char headerArchiveMagic[8] = {'T', 'E', 'H', 'D',
+                                               'R', 'P', 'A', 'K'};
+inline constexpr uint32_t headerArchiveVersion = 1;
+
+enum class HeaderArchiveEntryKind : uint32_t { Directory, File, Symlink };
+
+struct HeaderArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t entryCount;
+  uint64_t entriesOffset;
+  uint64_t stringTableOffset;
+  uint64_t stringTableSize;
+  // String offset of the absolute path the tree is mounted at.
+  uint32_t mountPoint;
+  uint32_t reserved;
+};
+
+struct HeaderArchiveEntry {
+  // String offset of the path, relative to the mount point.
+  uint32_t path;
+  uint32_t kind;
+  // In seconds since the epoch.
+  int64_t modificationTime;
+  // The contents of a file, or the target of a symlink.
+  uint64_t dataOffset;
+  uint64_t dataSize;
+};
+
+static_assert(sizeof(HeaderArchiveHeader) == 48);
+static_assert(sizeof(HeaderArchiveEntry) == 32);
+
+// A validated archive, mapped from disk.
+class HeaderArchive {
+private:
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  const HeaderArchiveHeader *Header = nullptr;
+  llvm::ArrayRef<HeaderArchiveEntry> Entries;
+
+  HeaderArchive() = default;
+  bool validate();
+  llvm::StringRef string(uint32_t offset) const;
+
+public:
+  static std::unique_ptr<HeaderArchive> open(llvm::StringRef path);
+
+  llvm::StringRef getMountPoint() const { return string(Header->mountPoint); }
+  llvm::ArrayRef<HeaderArchiveEntry> entries() const { return Entries; }
+  llvm::StringRef getPath(const HeaderArchiveEntry &entry) const {
+    return string(entry.path);
+  }
+  // Followed by a NUL, which isn't included.
+  llvm::StringRef getData(const HeaderArchiveEntry &entry) const;
+
+  // The index of the entry at `path` (relative to the mount point), without
+  //  following symlinks.
+  std::optional<size_t> lookup(llvm::StringRef path) const;
+  // The index of the directory or file at `path`, following symlinks that
+  //  point within the archive.
+  std::optional<size_t> resolve(llvm::StringRef path) const;
+};
+
+// A file system that serves everything under the archive's mount point from
+//  the archive (where anything missing doesn't exist), and everything else
+//  from `underlying`.
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> createHeaderArchiveFileSystem(
+    std::shared_ptr<const HeaderArchive> archive,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> underlying);
+
+// Run `te pack [--mount=<path>] <directory> <archive>`, packing a directory
+//  tree into a header archive.
+int runPack(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_HEADER_ARCHIVE_H
@@ -0,0 +1,163 @@
+#include "Merge.h"
+#include "DependencyOrder.h"
+#include "OutputDirectoryWriter.h"
+#include "RecordJSON.h"
+#include <algorithm>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct MergedReference {
+  std::string declID;
+  // Whether the referenced type's definition came before the record in its
+  //  file. A translation unit writes what a type contains by value (fields,
+  //  array elements, typedef targets) before it, so every by-value reference
+  //  is one of these, while pointers in a cycle aren't.
+  bool precedes;
+};
+
+struct MergedRecord {
+  std::string json;
+  bool isDefinition;
+  // The position of the ID in the order it was first seen.
+  unsigned node;
+  std::vector<MergedReference> references;
+};
+
+// Merges the records of every file, keeping the first definition of each
+//  ID (or the first forward declaration, if there's no definition).
+class DirectoryMerger {
+private:
+  llvm::StringMap<MergedRecord> Records;
+  // IDs in the order they were first seen.
+  std::vector<std::string> Order;
+
+public:
+  // Add the records of a file. Errors are printed.
+  bool addFile(llvm::StringRef path, bool isDefinition) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+      llvm::errs() << "te: can't read " << path << ": "
+                   << buffer.getError().message() << "\n";
+      return false;
+    }
+    // The IDs written so far in this file.
+    llvm::StringSet<> written;
+    std::vector<std::string> references;
+    llvm::StringRef contents = (*buffer)->getBuffer();
+    while (!contents.empty()) {
+      llvm::StringRef line;
+      std::tie(line, contents) = contents.split('\n');
+      if (line.trim().empty()) {
+        continue;
+      }
+      auto value = llvm::json::parse(line);
+      if (!value) {
+        llvm::errs() << "te: " << path << ": "
+                     << llvm::toString(value.takeError()) << "\n";
+        return false;
+      }
+      auto object = value->getAsObject();
+      auto type = object ? object->getObject("type") : nullptr;
+      auto declID = type ? type->getString("declID") : std::nullopt;
+      if (!declID) {
+        llvm::errs() << "te: " << path << ": expected records of the default "
+                        "format\n";
+        return false;
+      }
+      written.insert(*declID);
+      auto [it, inserted] = Records.try_emplace(*declID);
+      if (inserted) {
+        it->second.node = Order.size();
+        Order.push_back(declID->str());
+      } else if (it->second.isDefinition || !isDefinition) {
+        continue;
+      }
+      auto &record = it->second;
+      record.json = line.str();
+      record.isDefinition = isDefinition;
+      record.references.clear();
+      references.clear();
+      if (auto properties = object->get("properties")) {
+        collectReferences(*properties, references);
+      }
+      for (auto &reference : references) {
+        bool precedes = isDefinition && reference != *declID &&
+                        written.contains(reference);
+        record.references.push_back({std::move(reference), precedes});
+      }
+    }
+    return true;
+  }
+
+  // Write every record after the ones it references, as a single TU would
+  //  have. Cycles are broken at a reference that didn't come first in the
+  //  record's own file, so a record still comes after whatever it contains
+  //  by value.
+  void write(llvm::raw_ostream &OS) {
+    DependencyOrder dependencies;
+    auto getEdges = [&](unsigned node,
+                        llvm::SmallVectorImpl<DependencyEdge> &edges) {
+      for (const auto &reference : Records[Order[node]].references) {
+        auto it = Records.find(reference.declID);
+        if (it != Records.end()) {
+          edges.push_back({it->second.node, reference.precedes});
+        }
+      }
+    };
+    for (unsigned node = 0; node < Order.size(); ++node) {
+      dependencies.visit(node, getEdges, [&](unsigned emitted) {
+        OS << Records[Order[emitted]].json << "\n";
+      });
+    }
+    OS.flush();
+  }
+};
+
+void printUsage() {
+  llvm::errs() << "usage: te merge <output directory>\n";
+}
+
+} // namespace
+
+int runMerge(const std::vector<std::string> &args) {
+  if (args.size() != 1) {
+    printUsage();
+    return 1;
+  }
+
+  // Files are merged in name order, so the output doesn't depend on the
+  //  order the build happened to finish in.
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (llvm::sys::fs::directory_iterator it(args[0], error), end;
+       !error && it != end; it.increment(error)) {
+    if (llvm::StringRef(it->path()).ends_with(".jsonl")) {
+      paths.push_back(it->path());
+    }
+  }
+  if (error) {
+    llvm::errs() << "te: can't read " << args[0] << ": " << error.message()
+                 << "\n";
+    return 1;
+  }
+  std::sort(paths.begin(), paths.end());
+
+  DirectoryMerger merger;
+  for (const auto &path : paths) {
+    bool isDefinition =
+        !llvm::StringRef(path).ends_with(forwardDeclarationsExtension);
+    if (!merger.addFile(path, isDefinition)) {
+      return 1;
+    }
+  }
+  merger.write(llvm::outs());
+  return 0;
+}
@@ -0,0 +1,11 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_MERGE_H
+#define TYPE_EXTRACTOR_MERGE_H
+
+// Run `te merge <output directory>`, combining the per-TU output that the
+//  plugin wrote with `out-dir=` into one deduplicated stream on stdout.
+int runMerge(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_MERGE_H
@@ -0,0 +1,68 @@
+#include "TypeExtractorAction.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#ifndef TYPE_EXTRACTOR_OPTIONS_H
+#define TYPE_EXTRACTOR_OPTIONS_H
+
+// Consume an option that goes into `ExtractorOptions`, shared by the default
+//  command and `te batch`:
+//
+//   --include=<glob>, --exclude=<glob>
+//   --include-root=<pseudo-root>, --exclude-root=<pseudo-root>
+//   --root=<name>, --roots-file=<file with one name per line>
+//   --stats
+//   --serialize-threads=<n>
+//   --profile=default, --profile=extract
+//
+// Returns false if `arg` isn't one of them. Errors are printed, and leave
+//  `failed` set.
+inline bool consumeExtractorOption(llvm::StringRef arg,
+                                   ExtractorOptions &options, bool &failed) {
+  auto &filters = options.filters;
+  if (arg.consume_front("--include=")) {
+    filters.includePaths.push_back(arg.str());
+  } else if (arg.consume_front("--exclude=")) {
+    filters.excludePaths.push_back(arg.str());
+  } else if (arg.consume_front("--include-root=")) {
+    filters.includePseudoRoots.push_back(arg.str());
+  } else if (arg.consume_front("--exclude-root=")) {
+    filters.excludePseudoRoots.push_back(arg.str());
+  } else if (arg.consume_front("--root=")) {
+    options.rootNames.push_back(arg.str());
+  } else if (arg == "--stats") {
+    options.collectStats = true;
+  } else if (arg == "--profile=default") {
+    options.frontendProfile = FrontendProfile::Default;
+  } else if (arg == "--profile=extract") {
+    options.frontendProfile = FrontendProfile::Extract;
+  } else if (arg.consume_front("--serialize-threads=")) {
+    if (arg.getAsInteger(10, options.serializationThreads)) {
+      llvm::errs() << "te: invalid thread count: " << arg << "\n";
+      failed = true;
+    }
+  } else if (arg.consume_front("--roots-file=")) {
+    auto buffer = llvm::MemoryBuffer::getFile(arg);
+    if (!buffer) {
+      llvm::errs() << "te: can't read " << arg << ": "
+                   << buffer.getError().message() << "\n";
+      failed = true;
+      return true;
+    }
+    llvm::StringRef contents = (*buffer)->getBuffer();
+    while (!contents.empty()) {
+      llvm::StringRef line;
+      std::tie(line, contents) = contents.split('\n');
+      line = line.trim();
+      if (!line.empty()) {
+        options.rootNames.push_back(line.str());
+      }
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif // TYPE_EXTRACTOR_OPTIONS_H
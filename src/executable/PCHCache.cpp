@@ -0,0 +1,158 @@
+#include "PCHCache.h"
+#include "TypeExtractorAction.h"
+#include <clang/Basic/Version.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Lex/Lexer.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+
+namespace {
+
+// Have Clang check every input of the PCH on load, including system headers
+//  (which it skips by default), comparing contents when mtimes differ.
+void enablePCHInputValidation(clang::CompilerInstance &CI) {
+  CI.getHeaderSearchOpts().ModulesValidateSystemHeaders = true;
+  CI.getHeaderSearchOpts().ValidateASTInputFilesContent = true;
+}
+
+// Writes the preamble out as a PCH at a fixed path.
+class BuildPreamblePCHAction : public clang::GeneratePCHAction {
+private:
+  std::string OutputPath;
+
+public:
+  explicit BuildPreamblePCHAction(std::string outputPath)
+      : OutputPath(std::move(outputPath)) {}
+
+protected:
+  bool BeginInvocation(clang::CompilerInstance &CI) override {
+    CI.getFrontendOpts().OutputFile = OutputPath;
+    enablePCHInputValidation(CI);
+    return clang::GeneratePCHAction::BeginInvocation(CI);
+  }
+};
+
+// Extracts types with the preamble PCH implicitly included.
+class PreamblePCHExtractorAction : public TypeExtractorAction {
+private:
+  std::string PCHPath;
+  bool &Executed;
+
+public:
+  PreamblePCHExtractorAction(const ExtractorOptions &options,
+                             std::string pchPath, bool &executed)
+      : TypeExtractorAction(RecordHandler(), options),
+        PCHPath(std::move(pchPath)), Executed(executed) {}
+
+protected:
+  bool BeginInvocation(clang::CompilerInstance &CI) override {
+    CI.getPreprocessorOpts().ImplicitPCHInclude = PCHPath;
+    enablePCHInputValidation(CI);
+    return TypeExtractorAction::BeginInvocation(CI);
+  }
+
+  // Only reached if the PCH was loaded (and validated) successfully.
+  void ExecuteAction() override {
+    Executed = true;
+    TypeExtractorAction::ExecuteAction();
+  }
+};
+
+std::string hashCacheKey(const std::string &preamble,
+                         const std::vector<std::string> &args) {
+  llvm::SHA256 hasher;
+  hasher.update(clang::getClangFullVersion());
+  for (const auto &arg : args) {
+    hasher.update(llvm::StringRef(arg.c_str(), arg.size() + 1));
+  }
+  hasher.update(preamble);
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+bool buildPCH(const std::string &preamble, const std::string &preamblePath,
+              const std::string &pchPath,
+              const std::vector<std::string> &args) {
+  return clang::tooling::runToolOnCodeWithArgs(
+      std::make_unique<BuildPreamblePCHAction>(pchPath), preamble, args,
+      preamblePath);
+}
+
+} // namespace
+
+bool runWithPCHCache(const std::string &cacheDir, const std::string &code,
+                     const std::vector<std::string> &args,
+                     const ExtractorOptions &options) {
+  auto bounds = clang::Lexer::ComputePreamble(code, clang::LangOptions());
+  std::error_code error = llvm::sys::fs::create_directories(cacheDir);
+  if (bounds.Size == 0 || error) {
+    if (error) {
+      llvm::errs() << "te: can't create PCH cache directory: "
+                   << error.message() << "\n";
+    }
+    // Nothing worth caching, so just run as usual.
+    return clang::tooling::runToolOnCodeWithArgs(
+        std::make_unique<TypeExtractorAction>(RecordHandler(), options), code,
+        args, "header.h");
+  }
+
+  std::string preamble = code.substr(0, bounds.Size);
+  auto key = hashCacheKey(preamble, args);
+  llvm::SmallString<256> cachePath(cacheDir);
+  llvm::sys::fs::make_absolute(cachePath);
+  llvm::sys::path::append(cachePath, key);
+  // The preamble only ever exists in memory, but needs a stable absolute path
+  //  since the PCH records (and validates) it as an input.
+  auto preamblePath = (llvm::Twine(cachePath) + ".h").str();
+  auto pchPath = (llvm::Twine(cachePath) + ".pch").str();
+
+  // Blank out the preamble, keeping newlines so that line numbers still match.
+  std::string remainder = code;
+  for (size_t i = 0; i < bounds.Size; ++i) {
+    if (remainder[i] != '\n' && remainder[i] != '\r') {
+      remainder[i] = ' ';
+    }
+  }
+
+  bool built = false;
+  if (!llvm::sys::fs::exists(pchPath)) {
+    built = buildPCH(preamble, preamblePath, pchPath, args);
+  }
+
+  auto extract = [&]() {
+    bool executed = false;
+    bool result = clang::tooling::runToolOnCodeWithArgs(
+        std::make_unique<PreamblePCHExtractorAction>(options, pchPath,
+                                                     executed),
+        remainder, args, "header.h", "clang-tool",
+        std::make_shared<clang::PCHContainerOperations>(),
+        {{preamblePath, preamble}});
+    return std::make_pair(executed, result);
+  };
+
+  if (llvm::sys::fs::exists(pchPath)) {
+    auto [executed, result] = extract();
+    if (executed) {
+      return result;
+    }
+    // The cached PCH is stale, so rebuild it and try once more.
+    if (!built) {
+      llvm::sys::fs::remove(pchPath);
+      if (buildPCH(preamble, preamblePath, pchPath, args)) {
+        auto [retryExecuted, retryResult] = extract();
+        if (retryExecuted) {
+          return retryResult;
+        }
+      }
+    }
+  }
+
+  // Building or loading the PCH failed, so fall back to a full parse.
+  llvm::sys::fs::remove(pchPath);
+  return clang::tooling::runToolOnCodeWithArgs(
+      std::make_unique<TypeExtractorAction>(RecordHandler(), options), code,
+      args, "header.h");
+}
@@ -0,0 +1,16 @@
+#include "TypeExtractorAction.h"
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_PCH_CACHE_H
+#define TYPE_EXTRACTOR_PCH_CACHE_H
+
+// Extract types from `code` like the default mode does, but with its preamble
+//  (the leading run of `#include`s, `#import`s and other directives) served
+//  from a precompiled header in `cacheDir`. The PCH is built on a cache miss,
+//  and rebuilt if Clang finds that any of its inputs have changed.
+bool runWithPCHCache(const std::string &cacheDir, const std::string &code,
+                     const std::vector<std::string> &args,
+                     const ExtractorOptions &options);
+
+#endif // TYPE_EXTRACTOR_PCH_CACHE_H
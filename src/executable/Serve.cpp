@@ -0,0 +1,305 @@
+#include "Serve.h"
+#include "HeaderArchive.h"
+#include "Options.h"
+#include "RecordSink.h"
+#include "TypeExtractorAction.h"
+#include <clang/Basic/FileManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <clang/Tooling/Tooling.h>
+#include <iostream>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/raw_socket_stream.h>
+#include <optional>
+
+// Requests are JSON objects, one per line:
+//
+//   {"id": <any>, "args": [<clang args>...], "code": "<header contents>"}
+//   {"id": <any>, "flush": true}
+//
+// Each job is answered with its records (one per line, as in the default
+//  output), followed by:
+//
+//   {"done": true, "id": <the request's id>, "success": <bool>}
+//
+// with an "error" message for requests that couldn't be run at all. A
+//  "flush" request drops everything cached so far, for when headers changed.
+
+namespace {
+
+// The path the code of each job is parsed as. It only exists as an (empty)
+//  in-memory file, whose contents are replaced by the job's code.
+constexpr llvm::StringLiteral inputPath = "/te-serve/input.h";
+
+// A file whose contents are kept by the `CachingFileSystem`.
+class CachedFile : public llvm::vfs::File {
+private:
+  llvm::vfs::Status Status;
+  llvm::MemoryBufferRef Buffer;
+
+public:
+  CachedFile(llvm::vfs::Status status, llvm::MemoryBufferRef buffer)
+      : Status(std::move(status)), Buffer(buffer) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status() override { return Status; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const llvm::Twine &name, int64_t fileSize,
+            bool requiresNullTerminator, bool isVolatile) override {
+    return llvm::MemoryBuffer::getMemBuffer(Buffer.getBuffer(), name.str(),
+                                            requiresNullTerminator);
+  }
+
+  std::error_code close() override { return {}; }
+};
+
+// Remembers every stat (including failed ones, which header search makes a
+//  lot of) and the contents of every file read, so later jobs don't touch the
+//  disk for them. Not thread-safe, like the `FileManager` on top of it.
+class CachingFileSystem : public llvm::vfs::ProxyFileSystem {
+private:
+  struct Contents {
+    llvm::vfs::Status status;
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+  };
+  llvm::StringMap<llvm::ErrorOr<llvm::vfs::Status>> Statuses;
+  llvm::StringMap<Contents> Files;
+
+public:
+  explicit CachingFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+      : ProxyFileSystem(std::move(FS)) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &path) override {
+    llvm::SmallString<256> storage;
+    auto pathString = path.toStringRef(storage);
+    auto it = Statuses.find(pathString);
+    if (it == Statuses.end()) {
+      it = Statuses.try_emplace(pathString, getUnderlyingFS().status(path))
+               .first;
+    }
+    return it->second;
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &path) override {
+    llvm::SmallString<256> storage;
+    auto pathString = path.toStringRef(storage);
+    auto it = Files.find(pathString);
+    if (it == Files.end()) {
+      auto file = getUnderlyingFS().openFileForRead(path);
+      if (!file) {
+        return file.getError();
+      }
+      auto status = (*file)->status();
+      if (!status) {
+        return status.getError();
+      }
+      // Read (rather than map) the file, so it can't change underneath us.
+      auto buffer = (*file)->getBuffer(pathString, status->getSize(),
+                                       /*RequiresNullTerminator=*/true,
+                                       /*IsVolatile=*/true);
+      if (!buffer) {
+        return buffer.getError();
+      }
+      it = Files.try_emplace(pathString, Contents{*status, std::move(*buffer)})
+               .first;
+    }
+    return std::make_unique<CachedFile>(
+        it->second.status, it->second.buffer->getMemBufferRef());
+  }
+};
+
+// Everything kept warm between jobs.
+struct ServeState {
+  ExtractorOptions options;
+  // Served in place of the files under its mount point, if set.
+  std::shared_ptr<const HeaderArchive> archive;
+  llvm::IntrusiveRefCntPtr<clang::FileManager> files;
+
+  // (Re)create the file system and file manager, dropping anything cached.
+  void flush() {
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> fileSystem =
+        llvm::makeIntrusiveRefCnt<CachingFileSystem>(
+            llvm::vfs::getRealFileSystem());
+    if (archive) {
+      fileSystem = createHeaderArchiveFileSystem(archive, fileSystem);
+    }
+    auto overlay =
+        llvm::makeIntrusiveRefCnt<llvm::vfs::OverlayFileSystem>(fileSystem);
+    auto inMemory = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+    inMemory->addFile(inputPath, 0, llvm::MemoryBuffer::getMemBuffer(""));
+    overlay->pushOverlay(inMemory);
+    files = llvm::makeIntrusiveRefCnt<clang::FileManager>(
+        clang::FileSystemOptions(), overlay);
+  }
+};
+
+// Extracts types from the job's code, given as the contents of `inputPath`.
+class ServeJobAction : public TypeExtractorAction {
+private:
+  llvm::StringRef Code;
+
+public:
+  ServeJobAction(RecordSink &sink, const ExtractorOptions &options,
+                 llvm::StringRef code)
+      : TypeExtractorAction(sink, options), Code(code) {}
+
+protected:
+  bool BeginInvocation(clang::CompilerInstance &CI) override {
+    // Remapped rather than added to the file system, so that the shared
+    //  file manager never caches the code of a previous job.
+    CI.getPreprocessorOpts().addRemappedFile(
+        inputPath, llvm::MemoryBuffer::getMemBufferCopy(Code, inputPath)
+                       .release());
+    return TypeExtractorAction::BeginInvocation(CI);
+  }
+};
+
+void writeDone(llvm::raw_ostream &OS, const llvm::json::Value &id,
+               bool success, llvm::StringRef error = {}) {
+  llvm::json::OStream J(OS);
+  J.object([&] {
+    J.attribute("done", true);
+    J.attribute("id", id);
+    J.attribute("success", success);
+    if (!error.empty()) {
+      J.attribute("error", error);
+    }
+  });
+  OS << "\n";
+  OS.flush();
+}
+
+// Handle one request line, writing the response to `OS`.
+void handleRequest(ServeState &state, llvm::StringRef line,
+                   llvm::raw_ostream &OS) {
+  auto request = llvm::json::parse(line);
+  if (!request) {
+    writeDone(OS, nullptr, false, llvm::toString(request.takeError()));
+    return;
+  }
+  auto object = request->getAsObject();
+  if (!object) {
+    writeDone(OS, nullptr, false, "request is not an object");
+    return;
+  }
+  llvm::json::Value id = nullptr;
+  if (auto requestID = object->get("id")) {
+    id = *requestID;
+  }
+
+  if (object->getBoolean("flush").value_or(false)) {
+    state.flush();
+    writeDone(OS, id, true);
+    return;
+  }
+
+  auto code = object->getString("code");
+  if (!code) {
+    writeDone(OS, id, false, "missing \"code\"");
+    return;
+  }
+  std::vector<std::string> commandLine = {"clang-tool", "-fsyntax-only"};
+  if (auto args = object->getArray("args")) {
+    for (const auto &arg : *args) {
+      auto argString = arg.getAsString();
+      if (!argString) {
+        writeDone(OS, id, false, "\"args\" must be strings");
+        return;
+      }
+      commandLine.push_back(argString->str());
+    }
+  }
+  commandLine.push_back(inputPath.str());
+
+  JSONStreamSink sink(OS);
+  clang::tooling::ToolInvocation invocation(
+      commandLine, std::make_unique<ServeJobAction>(sink, state.options, *code),
+      state.files.get());
+  bool success = invocation.run();
+  writeDone(OS, id, success);
+}
+
+// Serve the requests of one Unix socket connection, until it's closed.
+void serveConnection(ServeState &state, llvm::raw_socket_stream &connection) {
+  std::string pending;
+  char chunk[65536];
+  while (true) {
+    ssize_t count = connection.read(chunk, sizeof(chunk));
+    if (count <= 0) {
+      return;
+    }
+    pending.append(chunk, size_t(count));
+    size_t start = 0;
+    for (size_t end; (end = pending.find('\n', start)) != std::string::npos;
+         start = end + 1) {
+      handleRequest(state, llvm::StringRef(pending).slice(start, end),
+                    connection);
+    }
+    pending.erase(0, start);
+  }
+}
+
+void printUsage() {
+  llvm::errs() << "usage: te serve [--socket=<path>] [--include=<glob>] "
+                  "[--exclude=<glob>] [--include-root=<root>] "
+                  "[--exclude-root=<root>] [--root=<name>] "
+                  "[--roots-file=<file>] [--stats] "
+                  "[--header-archive=<file>]\n";
+}
+
+} // namespace
+
+int runServe(const std::vector<std::string> &args) {
+  std::optional<std::string> socketPath;
+  ServeState state;
+  bool badOption = false;
+  for (const auto &argString : args) {
+    llvm::StringRef arg = argString;
+    if (arg.consume_front("--socket=")) {
+      socketPath = arg.str();
+    } else if (arg.consume_front("--header-archive=")) {
+      state.archive = HeaderArchive::open(arg);
+      if (!state.archive) {
+        llvm::errs() << "te: " << arg << " is not a valid header archive\n";
+        return 1;
+      }
+    } else if (consumeExtractorOption(arg, state.options, badOption)) {
+      if (badOption) {
+        return 1;
+      }
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+  state.flush();
+
+  if (!socketPath) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      handleRequest(state, line, llvm::outs());
+    }
+    return 0;
+  }
+
+  auto listener = llvm::ListeningSocket::createUnix(*socketPath);
+  if (!listener) {
+    llvm::errs() << "te: can't listen on " << *socketPath << ": "
+                 << llvm::toString(listener.takeError()) << "\n";
+    return 1;
+  }
+  // Connections are served one at a time, as they share the file manager.
+  while (true) {
+    auto connection = listener->accept();
+    if (!connection) {
+      llvm::errs() << "te: " << llvm::toString(connection.takeError()) << "\n";
+      return 1;
+    }
+    serveConnection(state, **connection);
+  }
+}
@@ -0,0 +1,13 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_SERVE_H
+#define TYPE_EXTRACTOR_SERVE_H
+
+// Run `te serve [--socket=<path>] [options]`, a long-running server that
+//  accepts extraction jobs as JSON lines (on stdin, or on each connection to
+//  a Unix socket) and streams back their records, keeping Clang's file state
+//  warm between jobs.
+int runServe(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_SERVE_H
@@ -0,0 +1,73 @@
+#include "Sweep.h"
+#include "LayoutSweep.h"
+#include "Options.h"
+#include "TypeExtractorAction.h"
+#include <atomic>
+#include <clang/Tooling/Tooling.h>
+#include <iostream>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <sstream>
+
+static void printUsage() {
+  llvm::errs() << "usage: te sweep --target=<triple> [--target=<triple>...] "
+                  "[--include=<glob>] [--exclude=<glob>] "
+                  "[--include-root=<root>] [--exclude-root=<root>] "
+                  "[--root=<name>] [--roots-file=<file>] [--stats] "
+                  "[args...]\n";
+}
+
+int runSweep(const std::vector<std::string> &args) {
+  std::vector<std::string> triples;
+  ExtractorOptions options;
+  bool badOption = false;
+
+  // Options for `te` itself come before any arguments for Clang.
+  size_t argIndex = 0;
+  for (; argIndex < args.size(); ++argIndex) {
+    llvm::StringRef arg = args[argIndex];
+    if (arg.consume_front("--target=")) {
+      triples.push_back(arg.str());
+    } else if (!consumeExtractorOption(arg, options, badOption)) {
+      break;
+    }
+  }
+  if (badOption) {
+    return 1;
+  }
+  if (triples.empty()) {
+    printUsage();
+    return 1;
+  }
+  std::vector<std::string> clangArgs(args.begin() + argIndex, args.end());
+
+  // Take code from standard input
+  std::string code =
+      std::string((std::stringstream() << std::cin.rdbuf()).str());
+
+  // Every target is parsed on its own thread, with its own file manager.
+  LayoutSweepMerger merger(triples);
+  std::atomic<bool> failed = false;
+  llvm::DefaultThreadPool pool(llvm::hardware_concurrency(triples.size()));
+  for (size_t i = 0; i < triples.size(); ++i) {
+    pool.async([&, i] {
+      std::vector<std::string> targetArgs = {"--target=" + triples[i]};
+      targetArgs.insert(targetArgs.end(), clangArgs.begin(), clangArgs.end());
+      if (!clang::tooling::runToolOnCodeWithArgs(
+              std::make_unique<TypeExtractorAction>(merger.getSink(i),
+                                                    options),
+              code, targetArgs, "header.h")) {
+        llvm::errs() << "te: extraction failed for " << triples[i] << "\n";
+        failed = true;
+      }
+    });
+  }
+  pool.wait();
+
+  // A partial sweep would look like types are missing for some targets.
+  if (failed) {
+    return 1;
+  }
+  merger.write(llvm::outs());
+  return 0;
+}
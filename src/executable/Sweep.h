@@ -0,0 +1,12 @@
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_SWEEP_H
+#define TYPE_EXTRACTOR_SWEEP_H
+
+// Run `te sweep --target=<triple>... [options] [args...]`, extracting the
+//  code from stdin for every target concurrently and writing each type once,
+//  with per-target layouts where they differ.
+int runSweep(const std::vector<std::string> &args);
+
+#endif // TYPE_EXTRACTOR_SWEEP_H
@@ -1,7 +1,18 @@
+#include "Batch.h"
+#include "Diff.h"
+#include "DumpBinary.h"
+#include "HeaderArchive.h"
+#include "Merge.h"
+#include "Options.h"
+#include "PCHCache.h"
+#include "Serve.h"
+#include "Sweep.h"
 #include "TypeExtractorAction.h"
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -14,10 +25,152 @@ int main(int argc, char **argv) {
     args.push_back(argv[i]);
   }
 
+  // Subcommands
+  if (!args.empty() && args.front() == "batch") {
+    return runBatch(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "serve") {
+    return runServe(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "sweep") {
+    return runSweep(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "diff") {
+    return runDiff(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "merge") {
+    return runMerge(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "pack") {
+    return runPack(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args.front() == "dump-binary") {
+    return runDumpBinary(
+        std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+
+  // Options for `te` itself come before any arguments for Clang.
+  std::optional<std::string> pchCacheDir;
+  std::optional<std::string> headerArchivePath;
+  std::optional<std::string> timeTracePath;
+  unsigned timeTraceGranularity = 0;
+  ExtractorOptions options;
+  bool failed = false;
+  while (!args.empty()) {
+    llvm::StringRef arg = args.front();
+    if (arg.consume_front("--pch-cache=")) {
+      pchCacheDir = arg.str();
+    } else if (arg.consume_front("--incremental-cache=")) {
+      options.incrementalCachePath = arg.str();
+    } else if (arg.consume_front("--header-archive=")) {
+      headerArchivePath = arg.str();
+    } else if (arg.consume_front("--time-trace=")) {
+      timeTracePath = arg.str();
+    } else if (arg.consume_front("--time-trace-granularity=")) {
+      if (arg.getAsInteger(10, timeTraceGranularity)) {
+        std::cerr << "te: invalid --time-trace-granularity\n";
+        failed = true;
+      }
+    } else if (arg == "--format=json") {
+      options.outputFormat = OutputFormat::JSON;
+    } else if (arg == "--format=binary") {
+      options.outputFormat = OutputFormat::Binary;
+    } else if (arg == "--format=normalized") {
+      options.outputFormat = OutputFormat::NormalizedJSON;
+    } else if (arg.consume_front("--shard-dir=")) {
+      options.shardDirectory = arg.str();
+    } else if (arg == "--async-output") {
+      options.asyncOutput = true;
+    } else if (arg == "--compress=gzip") {
+      options.outputCompression = OutputCompression::Gzip;
+    } else if (arg == "--compress=zstd") {
+      options.outputCompression = OutputCompression::Zstd;
+    } else if (consumeExtractorOption(arg, options, failed)) {
+      // Handled.
+    } else {
+      break;
+    }
+    args.erase(args.begin());
+  }
+
+  if (failed) {
+    return 1;
+  }
+
+  // Declarations loaded from a PCH can't be tracked by the incremental cache.
+  if (pchCacheDir && options.incrementalCachePath) {
+    std::cerr << "te: --pch-cache and --incremental-cache can't be combined\n";
+    return 1;
+  }
+  if (auto error =
+          AsyncOutputStream::getCompressionError(options.outputCompression)) {
+    std::cerr << "te: can't compress the output: " << error << "\n";
+    return 1;
+  }
+  // The PCH records the headers it was built from by their contents on disk.
+  if (pchCacheDir && headerArchivePath) {
+    std::cerr << "te: --pch-cache and --header-archive can't be combined\n";
+    return 1;
+  }
+  // The incremental cache only holds JSON.
+  if (options.incrementalCachePath &&
+      options.outputFormat != OutputFormat::JSON) {
+    std::cerr << "te: --incremental-cache requires --format=json\n";
+    return 1;
+  }
+
+  // Shards are JSON lines, written straight to their files.
+  if (options.shardDirectory &&
+      (options.outputFormat != OutputFormat::JSON || options.asyncOutput ||
+       options.outputCompression != OutputCompression::None)) {
+    std::cerr << "te: --shard-dir requires --format=json, without "
+                 "--async-output or --compress\n";
+    return 1;
+  }
+
   // Take code from standard input
   std::string code =
       std::string((std::stringstream() << std::cin.rdbuf()).str());
 
-  return clang::tooling::runToolOnCodeWithArgs(
-      std::make_unique<TypeExtractorAction>(), code, args, "header.h");
+  // Events shorter than the granularity (in microseconds) are dropped.
+  if (timeTracePath) {
+    llvm::timeTraceProfilerInitialize(timeTraceGranularity, "te");
+  }
+
+  int result;
+  if (pchCacheDir) {
+    result = runWithPCHCache(*pchCacheDir, code, args, options);
+  } else if (headerArchivePath) {
+    std::shared_ptr<const HeaderArchive> archive =
+        HeaderArchive::open(*headerArchivePath);
+    if (!archive) {
+      std::cerr << "te: " << *headerArchivePath
+                << " is not a valid header archive\n";
+      return 1;
+    }
+    auto overlay = llvm::makeIntrusiveRefCnt<llvm::vfs::OverlayFileSystem>(
+        createHeaderArchiveFileSystem(archive,
+                                      llvm::vfs::getRealFileSystem()));
+    auto inMemory = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+    // Pushing the overlay gives the in-memory file system the working
+    //  directory that the relative "header.h" is resolved against.
+    overlay->pushOverlay(inMemory);
+    inMemory->addFile("header.h", 0, llvm::MemoryBuffer::getMemBuffer(code));
+    result = clang::tooling::runToolOnCodeWithArgs(
+        std::make_unique<TypeExtractorAction>(RecordHandler(), options), code,
+        overlay, args, "header.h");
+  } else {
+    result = clang::tooling::runToolOnCodeWithArgs(
+        std::make_unique<TypeExtractorAction>(RecordHandler(), options), code,
+        args, "header.h");
+  }
+
+  if (timeTracePath) {
+    if (auto error = llvm::timeTraceProfilerWrite(*timeTracePath, "te")) {
+      std::cerr << "te: can't write the time trace: "
+                << llvm::toString(std::move(error)) << "\n";
+    }
+    llvm::timeTraceProfilerCleanup();
+  }
+  return result;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "RecordJSON.h"
+#include "ShardIndex.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Looks up types in the output of `te --shard-dir=<dir>`, reading only the
+//  records it needs through the index.
+namespace {
+
+class Query {
+private:
+  ShardIndex &Index;
+  bool WithDependencies;
+  llvm::StringSet<> Written;
+
+public:
+  Query(ShardIndex &index, bool withDependencies)
+      : Index(index), WithDependencies(withDependencies) {}
+
+  // Write the record, after the ones it references (unless they've been
+  //  written already). Returns false if any of them couldn't be read.
+  bool write(llvm::StringRef declID, llvm::StringRef json) {
+    if (!Written.insert(declID).second) {
+      return true;
+    }
+    bool success = true;
+    if (WithDependencies) {
+      auto value = llvm::json::parse(json);
+      if (!value) {
+        llvm::errs() << "te-query: " << declID << ": "
+                     << llvm::toString(value.takeError()) << "\n";
+        return false;
+      }
+      std::vector<std::string> references;
+      if (auto object = value->getAsObject()) {
+        if (auto properties = object->get("properties")) {
+          collectReferences(*properties, references);
+        }
+      }
+      for (const auto &reference : references) {
+        // Types that weren't extracted have no record to write.
+        auto location = Index.lookupID(reference);
+        if (!location || Written.contains(reference)) {
+          continue;
+        }
+        auto referenced = Index.readRecord(*location);
+        if (!referenced) {
+          llvm::errs() << "te-query: can't read the record of " << reference
+                       << "\n";
+          success = false;
+          continue;
+        }
+        success &= write(reference, *referenced);
+      }
+    }
+    llvm::outs() << json << "\n";
+    return success;
+  }
+
+  // Write the record with the ID, or failing that, the records with the type
+  //  name.
+  bool lookup(llvm::StringRef key) {
+    llvm::SmallVector<ShardLocation, 1> locations;
+    if (auto location = Index.lookupID(key)) {
+      locations.push_back(*location);
+    } else {
+      locations = Index.lookupName(key);
+    }
+    if (locations.empty()) {
+      llvm::errs() << "te-query: no type with the ID or name " << key << "\n";
+      return false;
+    }
+    bool success = true;
+    for (const auto &location : locations) {
+      auto json = Index.readRecord(location);
+      std::optional<std::string> declID;
+      if (json) {
+        auto value = llvm::json::parse(*json);
+        if (!value) {
+          llvm::consumeError(value.takeError());
+        } else if (auto object = value->getAsObject()) {
+          if (auto type = object->getObject("type")) {
+            if (auto typeDeclID = type->getString("declID")) {
+              declID = typeDeclID->str();
+            }
+          }
+        }
+      }
+      if (!declID) {
+        llvm::errs() << "te-query: can't read the record of " << key << "\n";
+        success = false;
+        continue;
+      }
+      success &= write(*declID, *json);
+    }
+    return success;
+  }
+};
+
+void printUsage() {
+  llvm::errs() << "usage: te-query [--no-deps] <shard dir> "
+                  "<declaration ID or type name>...\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<llvm::StringRef> args(argv + 1, argv + argc);
+  bool withDependencies = true;
+  if (!args.empty() && args.front() == "--no-deps") {
+    withDependencies = false;
+    args.erase(args.begin());
+  }
+  if (args.size() < 2) {
+    printUsage();
+    return 1;
+  }
+
+  auto index = ShardIndex::open(args.front());
+  if (!index) {
+    llvm::errs() << "te-query: " << args.front()
+                 << " doesn't have a valid index\n";
+    return 1;
+  }
+
+  Query query(*index, withDependencies);
+  bool success = true;
+  for (auto key : llvm::ArrayRef(args).drop_front()) {
+    success &= query.lookup(key);
+  }
+  llvm::outs().flush();
+  return success ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "AsyncOutputStream.h"
+#include <chrono>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/CRC.h>
+#include <llvm/Support/Compression.h>
+#include <llvm/Support/Endian.h>
+
+namespace {
+
+// Adds the time until it goes out of scope to `seconds`.
+class BlockedTimer {
+private:
+  double &Seconds;
+  std::chrono::steady_clock::time_point Start;
+
+public:
+  explicit BlockedTimer(double &seconds)
+      : Seconds(seconds), Start(std::chrono::steady_clock::now()) {}
+  ~BlockedTimer() {
+    Seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - Start)
+                   .count();
+  }
+};
+
+} // namespace
+
+AsyncOutputStream::AsyncOutputStream(llvm::raw_ostream &underlying,
+                                     OutputCompression compression)
+    : Underlying(underlying), Compression(compression) {
+  SetBufferSize(chunkSize);
+  Writer = std::thread([this] { runWriter(); });
+}
+
+AsyncOutputStream::~AsyncOutputStream() {
+  flush();
+  push({});
+  Writer.join();
+  Underlying.flush();
+}
+
+void AsyncOutputStream::write_impl(const char *ptr, size_t size) {
+  if (size == 0) {
+    return; // Empty chunks are reserved for the end.
+  }
+  Position += size;
+  push({ptr, size});
+}
+
+void AsyncOutputStream::push(llvm::StringRef chunk) {
+  uint64_t tail = Tail.load(std::memory_order_relaxed);
+  uint64_t head = Head.load(std::memory_order_acquire);
+  if (tail - head == queueCapacity) {
+    BlockedTimer timer(BlockedSeconds);
+    while (tail - head == queueCapacity) {
+      Head.wait(head, std::memory_order_acquire);
+      head = Head.load(std::memory_order_acquire);
+    }
+  }
+  // The writer is done with this slot, so its capacity can be reused.
+  Slots[tail % queueCapacity].assign(chunk.data(), chunk.size());
+  Tail.store(tail + 1, std::memory_order_release);
+  Tail.notify_one();
+}
+
+void AsyncOutputStream::drain() {
+  flush();
+  uint64_t tail = Tail.load(std::memory_order_relaxed);
+  uint64_t head = Head.load(std::memory_order_acquire);
+  if (head != tail) {
+    BlockedTimer timer(BlockedSeconds);
+    while (head != tail) {
+      Head.wait(head, std::memory_order_acquire);
+      head = Head.load(std::memory_order_acquire);
+    }
+  }
+}
+
+void AsyncOutputStream::runWriter() {
+  uint64_t head = Head.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t tail = Tail.load(std::memory_order_acquire);
+    if (head == tail) {
+      Tail.wait(tail, std::memory_order_acquire);
+      continue;
+    }
+    const std::string &chunk = Slots[head % queueCapacity];
+    bool end = chunk.empty();
+    writeChunk(chunk);
+    // Everything popped has been written, which `drain` relies on.
+    Underlying.flush();
+    Head.store(++head, std::memory_order_release);
+    Head.notify_one();
+    if (end) {
+      return;
+    }
+  }
+}
+
+void AsyncOutputStream::writeChunk(llvm::StringRef chunk) {
+  if (chunk.empty()) {
+    return;
+  }
+  switch (Compression) {
+  case OutputCompression::None:
+    Underlying << chunk;
+    return;
+  case OutputCompression::Gzip:
+    writeGzipMember(chunk);
+    return;
+  case OutputCompression::Zstd:
+    Compressed.clear();
+    llvm::compression::zstd::compress(llvm::arrayRefFromStringRef(chunk),
+                                      Compressed);
+    break;
+  }
+  Underlying << llvm::toStringRef(Compressed);
+}
+
+// Decoders stop after the first of consecutive zlib streams, but read all
+//  of the members of a gzip file. Both wrap the same raw deflate data, so
+//  the zlib header (2 bytes, without a preset dictionary) and Adler-32
+//  trailer are swapped for a gzip header and a CRC-32 and size trailer.
+void AsyncOutputStream::writeGzipMember(llvm::StringRef chunk) {
+  Compressed.clear();
+  auto data = llvm::arrayRefFromStringRef(chunk);
+  llvm::compression::zlib::compress(data, Compressed);
+  // Magic, deflate, no flags, no modification time, no extra flags, unknown
+  //  operating system.
+  static const char header[] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+  Underlying.write(header, sizeof(header));
+  Underlying << llvm::toStringRef(Compressed).drop_front(2).drop_back(4);
+  char trailer[8];
+  llvm::support::endian::write32le(trailer, llvm::crc32(data));
+  llvm::support::endian::write32le(trailer + 4, uint32_t(chunk.size()));
+  Underlying.write(trailer, sizeof(trailer));
+}
+
+const char *
+AsyncOutputStream::getCompressionError(OutputCompression compression) {
+  switch (compression) {
+  case OutputCompression::None:
+    return nullptr;
+  case OutputCompression::Gzip:
+    return llvm::compression::getReasonIfUnsupported(
+        llvm::compression::Format::Zlib);
+  case OutputCompression::Zstd:
+    return llvm::compression::getReasonIfUnsupported(
+        llvm::compression::Format::Zstd);
+  }
+  return nullptr;
+}
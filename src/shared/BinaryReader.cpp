@@ -0,0 +1,62 @@
+#include "BinaryReader.h"
+
+static llvm::StringRef toStringRef(std::string_view string) {
+  return {string.data(), string.size()};
+}
+
+static DeclIDAndTypeName toDeclIDAndTypeName(const BinaryTypeFile &file,
+                                             const BinaryTypeRef &type) {
+  DeclIDAndTypeName result;
+  if (auto declID = file.optionalString(type.declID)) {
+    result.declID = toStringRef(*declID);
+  }
+  result.typeName = toStringRef(file.string(type.typeName));
+  return result;
+}
+
+TypeRecord readBinaryRecord(const BinaryTypeFile &file,
+                            const BinaryRecordView &view) {
+  TypeRecord record;
+  record.kind = TypeKind(view.kind());
+  record.type = toDeclIDAndTypeName(file, view.type());
+  record.isDefinition = view.isDefinition();
+  record.pseudoRoot = toStringRef(file.string(view.pseudoRoot()));
+  record.hash = view.hash();
+  for (auto component : view.location()) {
+    record.location.push_back(toStringRef(file.string(component)));
+  }
+  auto auxiliaryType = toDeclIDAndTypeName(file, view.auxiliaryType());
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    record.underlyingType = auxiliaryType;
+    break;
+  case TypeKind::Struct:
+    for (const auto &field : view.fields()) {
+      record.fields.push_back({toStringRef(file.string(field.name)),
+                               field.offset, field.size,
+                               toDeclIDAndTypeName(file, field.type)});
+    }
+    break;
+  case TypeKind::Union:
+    for (const auto &member : view.namedTypes()) {
+      record.members.push_back({toStringRef(file.string(member.name)),
+                                toDeclIDAndTypeName(file, member.type)});
+    }
+    break;
+  case TypeKind::Enum:
+    record.backingType = auxiliaryType;
+    for (const auto &entry : view.entries()) {
+      record.entries.push_back(
+          {toStringRef(file.string(entry.name)), entry.value});
+    }
+    break;
+  case TypeKind::Function:
+    record.returnType = auxiliaryType;
+    for (const auto &param : view.namedTypes()) {
+      record.params.push_back({toStringRef(file.string(param.name)),
+                               toDeclIDAndTypeName(file, param.type)});
+    }
+    break;
+  }
+  return record;
+}
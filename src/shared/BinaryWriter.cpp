@@ -0,0 +1,149 @@
+#include "BinaryWriter.h"
+#include <llvm/Support/ErrorHandling.h>
+
+static_assert(uint8_t(BinaryTypeKind::Typedef) == uint8_t(TypeKind::Typedef) &&
+                  uint8_t(BinaryTypeKind::Struct) == uint8_t(TypeKind::Struct) &&
+                  uint8_t(BinaryTypeKind::Union) == uint8_t(TypeKind::Union) &&
+                  uint8_t(BinaryTypeKind::Enum) == uint8_t(TypeKind::Enum) &&
+                  uint8_t(BinaryTypeKind::Function) ==
+                      uint8_t(TypeKind::Function),
+              "BinaryTypeKind must match TypeKind");
+
+BinaryWriter::BinaryWriter(llvm::raw_ostream &OS) : OS(OS) {}
+
+void BinaryWriter::writeFileHeader() {
+  BinaryFileHeader header = {};
+  std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+  header.version = binaryVersion;
+  write(&header, sizeof(header));
+}
+
+void BinaryWriter::write(const void *data, size_t size) {
+  OS.write(static_cast<const char *>(data), size);
+  Position += size;
+}
+
+void BinaryWriter::pad() {
+  static const char zeroes[8] = {};
+  if (Position % 8 != 0) {
+    write(zeroes, 8 - Position % 8);
+  }
+}
+
+uint32_t BinaryWriter::intern(llvm::StringRef string) {
+  auto [it, inserted] = StringOffsets.try_emplace(string, StringTable.size());
+  if (inserted) {
+    StringTable.append(string.begin(), string.end());
+    StringTable.push_back('\0');
+    if (StringTable.size() >= binaryNoString) {
+      llvm::report_fatal_error("te: binary string table is too large");
+    }
+  }
+  return it->second;
+}
+
+BinaryTypeRef BinaryWriter::internTypeRef(const DeclIDAndTypeName &type) {
+  return {type.declID ? intern(*type.declID) : binaryNoString,
+          intern(type.typeName)};
+}
+
+void BinaryWriter::handleRecord(const TypeRecord &record) {
+  if (Position == 0) {
+    writeFileHeader();
+  }
+  RecordOffsets.push_back(Position);
+
+  BinaryRecordHeader header = {};
+  header.kind = uint8_t(record.kind);
+  header.isDefinition = record.isDefinition;
+  header.locationCount = record.location.size();
+  header.pseudoRoot = intern(record.pseudoRoot);
+  header.type = internTypeRef(record.type);
+  header.hash = record.hash;
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    header.auxiliaryType = internTypeRef(record.underlyingType);
+    break;
+  case TypeKind::Struct:
+    header.itemCount = record.fields.size();
+    header.auxiliaryType = {binaryNoString, binaryNoString};
+    break;
+  case TypeKind::Union:
+    header.itemCount = record.members.size();
+    header.auxiliaryType = {binaryNoString, binaryNoString};
+    break;
+  case TypeKind::Enum:
+    header.itemCount = record.entries.size();
+    header.auxiliaryType = internTypeRef(record.backingType);
+    break;
+  case TypeKind::Function:
+    header.itemCount = record.params.size();
+    header.auxiliaryType = internTypeRef(record.returnType);
+    break;
+  }
+  write(&header, sizeof(header));
+
+  for (const auto &component : record.location) {
+    uint32_t offset = intern(component);
+    write(&offset, sizeof(offset));
+  }
+  pad();
+
+  auto writeNamedTypes = [&](llvm::ArrayRef<NamedType> types) {
+    for (const auto &type : types) {
+      BinaryNamedType item = {};
+      item.name = intern(type.name);
+      item.type = internTypeRef(type.type);
+      write(&item, sizeof(item));
+    }
+  };
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    break;
+  case TypeKind::Struct:
+    for (const auto &field : record.fields) {
+      BinaryStructField item = {};
+      item.name = intern(field.name);
+      item.offset = field.offset;
+      item.size = field.size;
+      item.type = internTypeRef(field.type);
+      write(&item, sizeof(item));
+    }
+    break;
+  case TypeKind::Union:
+    writeNamedTypes(record.members);
+    break;
+  case TypeKind::Enum:
+    for (const auto &entry : record.entries) {
+      BinaryEnumEntry item = {};
+      item.name = intern(entry.name);
+      item.value = entry.value;
+      write(&item, sizeof(item));
+    }
+    break;
+  case TypeKind::Function:
+    writeNamedTypes(record.params);
+    break;
+  }
+}
+
+void BinaryWriter::finish() {
+  if (Position == 0) {
+    writeFileHeader();
+  }
+
+  BinaryFileFooter footer = {};
+  footer.stringTableOffset = Position;
+  footer.stringTableSize = StringTable.size();
+  write(StringTable.data(), StringTable.size());
+  pad();
+
+  footer.recordIndexOffset = Position;
+  footer.recordCount = RecordOffsets.size();
+  write(RecordOffsets.data(), RecordOffsets.size() * sizeof(uint64_t));
+
+  footer.version = binaryVersion;
+  std::memcpy(footer.magic, binaryMagic, sizeof(binaryMagic));
+  write(&footer, sizeof(footer));
+  OS.flush();
+}
@@ -0,0 +1,41 @@
+#include "BinaryFormat.h"
+#include "RecordSink.h"
+#include "TypeRecord.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_BINARY_WRITER_H
+#define TYPE_EXTRACTOR_BINARY_WRITER_H
+
+// Writes records in the binary format described in `BinaryFormat.h`. Records
+//  are streamed out as they come, while the string table and record index are
+//  kept in memory until `finish`. Nothing is written before the first record,
+//  so an extraction that fails early leaves the output empty.
+class BinaryWriter : public RecordSink {
+private:
+  llvm::raw_ostream &OS;
+  uint64_t Position = 0;
+  llvm::StringMap<uint32_t> StringOffsets;
+  std::string StringTable;
+  std::vector<uint64_t> RecordOffsets;
+
+  void writeFileHeader();
+  void write(const void *data, size_t size);
+  void pad();
+  uint32_t intern(llvm::StringRef string);
+  BinaryTypeRef internTypeRef(const DeclIDAndTypeName &type);
+
+public:
+  explicit BinaryWriter(llvm::raw_ostream &OS);
+
+  void handleRecord(const TypeRecord &record) override;
+
+  // Write the string table, record index and footer.
+  void finish() override;
+
+  uint64_t getBytesWritten() const override { return Position; }
+};
+
+#endif // TYPE_EXTRACTOR_BINARY_WRITER_H
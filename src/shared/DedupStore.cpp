@@ -0,0 +1,141 @@
+#include "DedupStore.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+inline constexpr char dedupStoreMagic[8] = {'T', 'E', 'D', 'E',
+                                            'D', 'U', 'P', 'S'};
+inline constexpr uint32_t dedupStoreVersion = 2;
+// Enough for the types of a few large SDKs. The file is sparse, so pages of
+//  the table that are never touched don't take up space.
+inline constexpr uint64_t dedupStoreCapacity = uint64_t(1) << 22;
+// Slots probed for an ID before giving up on it.
+inline constexpr uint64_t dedupStoreMaxProbes = 64;
+
+struct DedupStoreHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  // Number of slots, a power of two. Each slot is the hash of an ID
+  //  followed by the hash of its owner.
+  uint64_t capacity;
+  uint64_t reserved2[5];
+};
+
+static_assert(sizeof(DedupStoreHeader) == 64);
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free);
+
+// Create the table if the file is new. Runs under the file's lock.
+bool initialize(int fd) {
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    return false;
+  }
+  if (status.st_size != 0) {
+    return true;
+  }
+  DedupStoreHeader header = {};
+  std::memcpy(header.magic, dedupStoreMagic, sizeof(dedupStoreMagic));
+  header.version = dedupStoreVersion;
+  header.capacity = dedupStoreCapacity;
+  off_t size = sizeof(header) + dedupStoreCapacity * 2 * sizeof(uint64_t);
+  return ftruncate(fd, size) == 0 &&
+         pwrite(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header));
+}
+
+} // namespace
+
+DedupStore::~DedupStore() { munmap(Mapping, Size); }
+
+std::unique_ptr<DedupStore> DedupStore::open(llvm::StringRef path) {
+  auto fail = [&](const char *what) -> std::unique_ptr<DedupStore> {
+    llvm::errs() << "te: can't " << what << " the dedup store " << path << ": "
+                 << std::strerror(errno) << "\n";
+    return nullptr;
+  };
+
+  llvm::SmallString<256> pathString(path);
+  int fd = ::open(pathString.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return fail("open");
+  }
+  // Whoever gets the lock first creates the table, and everyone else waits
+  //  for that to finish.
+  if (flock(fd, LOCK_EX) != 0 || !initialize(fd) || flock(fd, LOCK_UN) != 0) {
+    auto result = fail("create");
+    close(fd);
+    return result;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    auto result = fail("read");
+    close(fd);
+    return result;
+  }
+  size_t size = size_t(status.st_size);
+  void *mapping =
+      size < sizeof(DedupStoreHeader)
+          ? MAP_FAILED
+          : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return fail("map");
+  }
+
+  auto header = static_cast<const DedupStoreHeader *>(mapping);
+  uint64_t capacity = header->capacity;
+  if (std::memcmp(header->magic, dedupStoreMagic, sizeof(dedupStoreMagic)) !=
+          0 ||
+      header->version != dedupStoreVersion || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0 ||
+      capacity > (size - sizeof(DedupStoreHeader)) / (2 * sizeof(uint64_t))) {
+    munmap(mapping, size);
+    llvm::errs() << "te: " << path << " is not a valid dedup store\n";
+    return nullptr;
+  }
+  auto slots = reinterpret_cast<uint64_t *>(static_cast<char *>(mapping) +
+                                            sizeof(DedupStoreHeader));
+  return std::unique_ptr<DedupStore>(
+      new DedupStore(mapping, size, slots, capacity));
+}
+
+bool DedupStore::claim(llvm::StringRef declID, uint64_t owner) {
+  // Zero marks an empty slot, or one whose owner isn't set yet.
+  uint64_t hash = llvm::xxh3_64bits(llvm::arrayRefFromStringRef(declID));
+  if (hash == 0) {
+    hash = 1;
+  }
+  if (owner == 0) {
+    owner = 1;
+  }
+  for (uint64_t probe = 0; probe < dedupStoreMaxProbes; ++probe) {
+    uint64_t *entry = &Slots[2 * ((hash + probe) & (Capacity - 1))];
+    std::atomic_ref<uint64_t> slot(entry[0]);
+    std::atomic_ref<uint64_t> slotOwner(entry[1]);
+    uint64_t existing = slot.load(std::memory_order_relaxed);
+    if (existing == 0 && slot.compare_exchange_strong(
+                             existing, hash, std::memory_order_relaxed)) {
+      slotOwner.store(owner, std::memory_order_relaxed);
+      return true;
+    }
+    // Either it was already taken, or someone else just took it (in which
+    //  case its owner may not be set yet, but it isn't this one, as an
+    //  output is only written by one process at a time).
+    if (existing == hash) {
+      return slotOwner.load(std::memory_order_relaxed) == owner;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <cstdint>
+#include <llvm/ADT/StringRef.h>
+#include <memory>
+
+#ifndef TYPE_EXTRACTOR_DEDUP_STORE_H
+#define TYPE_EXTRACTOR_DEDUP_STORE_H
+
+// A set of stable declaration IDs that concurrent processes share through a
+//  memory-mapped file, so that the compilers of one build agree on which of
+//  them writes each type. The file is an open-addressed table of 64-bit
+//  hashes of the IDs, each along with a hash of its owner (the output that
+//  claimed it), which are inserted with a compare-and-swap, so only
+//  creating the file takes a lock.
+class DedupStore {
+private:
+  void *Mapping;
+  size_t Size;
+  uint64_t *Slots;
+  uint64_t Capacity;
+
+  DedupStore(void *mapping, size_t size, uint64_t *slots, uint64_t capacity)
+      : Mapping(mapping), Size(size), Slots(slots), Capacity(capacity) {}
+
+public:
+  DedupStore(const DedupStore &) = delete;
+  DedupStore &operator=(const DedupStore &) = delete;
+  ~DedupStore();
+
+  // Open the store at `path`, creating it if it doesn't exist. Errors are
+  //  printed.
+  static std::unique_ptr<DedupStore> open(llvm::StringRef path);
+
+  // Claim the ID for `owner`, a hash identifying the output it's written to.
+  //  Returns false if it was claimed before by another owner, in any
+  //  process, so that an incremental rebuild writes the IDs it owns again.
+  //  Once the table is too full to find a slot, every ID counts as new.
+  bool claim(llvm::StringRef declID, uint64_t owner);
+};
+
+#endif // TYPE_EXTRACTOR_DEDUP_STORE_H
@@ -0,0 +1,38 @@
+#include "ExtractionStats.h"
+#include <iterator>
+#include <llvm/Support/Format.h>
+
+void ExtractionStats::print(llvm::raw_ostream &OS) const {
+  auto percentage = [](uint64_t part, uint64_t whole) {
+    return llvm::format("%.1f%%", whole ? 100.0 * part / whole : 0.0);
+  };
+  uint64_t records = replayedRecords;
+  for (auto count : recordsByKind) {
+    records += count;
+  }
+
+  OS << "te: extraction stats\n";
+  OS << "  records:            " << records << "\n";
+  for (size_t kind = 0; kind < std::size(recordsByKind); ++kind) {
+    OS << "    " << llvm::left_justify(typeKindName(TypeKind(kind)), 16)
+       << recordsByKind[kind] << "\n";
+  }
+  OS << "    replayed        " << replayedRecords << "\n";
+  OS << "  bytes emitted:      " << bytesEmitted << "\n";
+  OS << "  skipped decls:      " << skippedDecls << "\n";
+  OS << "  dedup hits:         " << dedupHits << " of " << dedupLookups << " ("
+     << percentage(dedupHits, dedupLookups) << ")\n";
+  OS << "  shared dedup hits:  " << sharedDedupHits << "\n";
+  OS << "  path cache hits:    " << pathHits << " of " << pathLookups << " ("
+     << percentage(pathHits, pathLookups) << ")\n";
+  OS << "  type cache hits:    " << typeCacheHits << " of " << typeCacheLookups
+     << " (" << percentage(typeCacheHits, typeCacheLookups) << ")\n";
+  OS << "  time:\n";
+  for (size_t phase = 0; phase < extractionPhaseCount; ++phase) {
+    OS << "    "
+       << llvm::left_justify(extractionPhaseName(ExtractionPhase(phase)), 16)
+       << llvm::format("%.2f ms", phaseSeconds[phase] * 1000) << "\n";
+  }
+  OS << "    " << llvm::left_justify("output blocked", 16)
+     << llvm::format("%.2f ms", outputBlockedSeconds * 1000) << "\n";
+}
@@ -0,0 +1,44 @@
+#include "FrontendProfile.h"
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/raw_ostream.h>
+
+void ErrorOnlyDiagnosticConsumer::HandleDiagnostic(
+    clang::DiagnosticsEngine::Level level, const clang::Diagnostic &info) {
+  // Counts errors and warnings, which is what decides if the run failed.
+  DiagnosticConsumer::HandleDiagnostic(level, info);
+  if (level < clang::DiagnosticsEngine::Error) {
+    return;
+  }
+  llvm::SmallString<256> message;
+  info.FormatDiagnostic(message);
+  auto &OS = llvm::errs();
+  if (info.hasSourceManager() && info.getLocation().isValid()) {
+    auto presumed =
+        info.getSourceManager().getPresumedLoc(info.getLocation());
+    if (presumed.isValid()) {
+      OS << presumed.getFilename() << ":" << presumed.getLine() << ":"
+         << presumed.getColumn() << ": ";
+    }
+  }
+  OS << (level == clang::DiagnosticsEngine::Fatal ? "fatal error: "
+                                                  : "error: ")
+     << message << "\n";
+}
+
+void applyExtractProfile(clang::CompilerInstance &CI) {
+  // Records only describe declarations, and whatever a body contains is
+  //  scoped to it, so bodies are only parsed as far as skipping them goes.
+  //  Not in C++ though, where a body can instantiate a class template
+  //  specialization that is then emitted (or give a deduced return type).
+  if (!CI.getLangOpts().CPlusPlus) {
+    CI.getFrontendOpts().SkipFunctionBodies = true;
+  }
+
+  // Warnings are never shown, so they don't need to be formatted (or even
+  //  checked for, in most cases).
+  auto &diagnostics = CI.getDiagnostics();
+  diagnostics.setIgnoreAllWarnings(true);
+  diagnostics.setClient(new ErrorOnlyDiagnosticConsumer(),
+                        /*ShouldOwnClient=*/true);
+}
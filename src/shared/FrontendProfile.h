@@ -0,0 +1,20 @@
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/CompilerInstance.h>
+
+#ifndef TYPE_EXTRACTOR_FRONTEND_PROFILE_H
+#define TYPE_EXTRACTOR_FRONTEND_PROFILE_H
+
+// Prints errors as single lines, without the source excerpts, carets, notes
+//  and fix-its that `TextDiagnosticPrinter` formats, and drops everything
+//  below an error.
+class ErrorOnlyDiagnosticConsumer : public clang::DiagnosticConsumer {
+public:
+  void HandleDiagnostic(clang::DiagnosticsEngine::Level level,
+                        const clang::Diagnostic &info) override;
+};
+
+// Configure the compiler for `FrontendProfile::Extract`, before the source
+//  file is begun.
+void applyExtractProfile(clang::CompilerInstance &CI);
+
+#endif // TYPE_EXTRACTOR_FRONTEND_PROFILE_H
@@ -0,0 +1,224 @@
+#include "IncrementalCache.h"
+#include <algorithm>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+// The cache is a line-based text file:
+//
+//   te-incremental-cache 4 <seed>
+//   F <content hash> <file path>
+//   R <prefix hash> <is definition> <record hash> <ID length> <ID><JSON>
+//   D <referenced record hash, or - if unset> <referenced ID>
+//
+// with the "R" lines of a file following its "F" line, and the "D" lines of
+//  a record following its "R" line. Hashes are in hex.
+static constexpr llvm::StringLiteral cacheMagic = "te-incremental-cache 4 ";
+
+static uint64_t combineHashes(uint64_t first, uint64_t second) {
+  uint64_t data[] = {first, second};
+  return llvm::xxh3_64bits(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(data), sizeof(data)));
+}
+
+IncrementalCache::IncrementalCache(std::string path, uint64_t seed)
+    : Path(std::move(path)), Seed(seed) {
+  load();
+}
+
+void IncrementalCache::load() {
+  auto buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!buffer) {
+    return; // No cache yet.
+  }
+  llvm::StringRef contents = (*buffer)->getBuffer();
+  llvm::StringRef header;
+  std::tie(header, contents) = contents.split('\n');
+  uint64_t seed;
+  if (!header.consume_front(cacheMagic) || header.getAsInteger(16, seed) ||
+      seed != Seed) {
+    return; // Different format or different invocation, so start over.
+  }
+
+  uint64_t contentHash = 0;
+  Record *last = nullptr;
+  while (!contents.empty()) {
+    llvm::StringRef line;
+    std::tie(line, contents) = contents.split('\n');
+    if (line.consume_front("F ")) {
+      if (line.split(' ').first.getAsInteger(16, contentHash)) {
+        Previous.clear();
+        return; // Corrupt cache.
+      }
+    } else if (line.consume_front("R ")) {
+      auto [prefixHash, rest] = line.split(' ');
+      auto [isDefinition, rest2] = rest.split(' ');
+      auto [recordHash, rest3] = rest2.split(' ');
+      auto [idLength, rest4] = rest3.split(' ');
+      Record record;
+      size_t length;
+      if (prefixHash.getAsInteger(16, record.position.prefixHash) ||
+          recordHash.getAsInteger(16, record.hash) ||
+          idLength.getAsInteger(10, length) || length > rest4.size()) {
+        Previous.clear();
+        return; // Corrupt cache.
+      }
+      record.position.contentHash = contentHash;
+      record.isDefinition = isDefinition == "1";
+      record.json = rest4.drop_front(length).str();
+      last = &(Previous[rest4.take_front(length)] = std::move(record));
+    } else if (line.consume_front("D ")) {
+      auto [hash, declID] = line.split(' ');
+      std::optional<uint64_t> referencedHash;
+      if (hash != "-" && hash.getAsInteger(16, referencedHash.emplace())) {
+        last = nullptr;
+      }
+      if (!last) {
+        Previous.clear();
+        return; // Corrupt cache.
+      }
+      last->references.emplace_back(Saver.save(declID), referencedHash);
+    }
+  }
+}
+
+void IncrementalCache::indexTranslationUnit(const clang::SourceManager &SM) {
+  Files.clear();
+  Current.clear();
+  CurrentFileOrder.clear();
+
+  // Entries are allocated in the order files are entered, so walking them in
+  //  order gives the running hash of every file entered so far.
+  llvm::DenseMap<const clang::SrcMgr::ContentCache *, uint64_t> contentHashes;
+  uint64_t prefixHash = Seed;
+  for (unsigned i = 0, e = SM.local_sloc_entry_size(); i != e; ++i) {
+    const auto &entry = SM.getLocalSLocEntry(i);
+    if (!entry.isFile()) {
+      continue;
+    }
+    const auto &contentCache = entry.getFile().getContentCache();
+    auto [it, inserted] = contentHashes.try_emplace(&contentCache, 0);
+    if (inserted) {
+      uint64_t nameHash = 0;
+      if (contentCache.OrigEntry) {
+        nameHash = llvm::xxh3_64bits(
+            llvm::arrayRefFromStringRef(contentCache.OrigEntry->getName()));
+      }
+      uint64_t bufferHash = 0;
+      if (auto buffer = contentCache.getBufferIfLoaded()) {
+        bufferHash =
+            llvm::xxh3_64bits(llvm::arrayRefFromStringRef(buffer->getBuffer()));
+      }
+      it->second = combineHashes(nameHash, bufferHash);
+    }
+    prefixHash = combineHashes(prefixHash, it->second);
+    Files.push_back({entry.getOffset(), entry.getFile().getIncludeLoc(),
+                     {it->second, prefixHash}});
+  }
+}
+
+CachePosition IncrementalCache::locate(const clang::SourceManager &SM,
+                                       clang::SourceLocation expansionLoc) const {
+  auto fileStart = SM.getSLocEntry(SM.getFileID(expansionLoc)).getOffset();
+  auto own = std::upper_bound(
+      Files.begin(), Files.end(), fileStart,
+      [](clang::SourceLocation::UIntTy offset, const FileEntry &file) {
+        return offset < file.offset;
+      });
+  // An included file's entry (and offsets) come after all of the including
+  //  file's, so whether a file was entered before the declaration depends on
+  //  where it was included from. Files are entered in lexing order, so the
+  //  ones that were are a prefix of the entries.
+  auto last = std::partition_point(
+      Files.begin(), Files.end(), [&](const FileEntry &file) {
+        return file.includeLoc.isInvalid() ||
+               SM.isBeforeInTranslationUnit(file.includeLoc, expansionLoc);
+      });
+  if (last == Files.begin() || own == Files.begin()) {
+    return {0, 0}; // Not in a local file, so never matches a cached record.
+  }
+  return {std::prev(own)->position.contentHash,
+          std::prev(last)->position.prefixHash};
+}
+
+const IncrementalCache::Record *IncrementalCache::lookup(
+    llvm::StringRef declID, const CachePosition &position,
+    llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)> getHash)
+    const {
+  auto it = Previous.find(declID);
+  if (it == Previous.end() || position.prefixHash == 0) {
+    return nullptr;
+  }
+  const auto &record = it->second;
+  // The declaration's own file must be unchanged, as well as anything that
+  //  came before it.
+  if (record.position.contentHash != position.contentHash ||
+      record.position.prefixHash != position.prefixHash) {
+    return nullptr;
+  }
+  // The records it references could have changed even so, if they're
+  //  declared in a later file.
+  for (const auto &[referencedID, hash] : record.references) {
+    if (getHash(referencedID) != hash) {
+      return nullptr;
+    }
+  }
+  return &record;
+}
+
+void IncrementalCache::store(llvm::StringRef filePath, llvm::StringRef declID,
+                             const CachePosition &position, bool isDefinition,
+                             uint64_t hash,
+                             llvm::ArrayRef<CacheReference> references,
+                             llvm::StringRef json) {
+  // TU-local fallback IDs can't be matched up between runs.
+  if (declID.starts_with("#") || json.contains(R"("declID":"#)")) {
+    return;
+  }
+  auto [it, inserted] = Current.try_emplace(filePath);
+  if (inserted) {
+    CurrentFileOrder.push_back(filePath.str());
+  }
+  Record record{position, isDefinition, hash, {}, json.str()};
+  for (const auto &[referencedID, referencedHash] : references) {
+    record.references.emplace_back(Saver.save(referencedID), referencedHash);
+  }
+  it->second.emplace_back(declID.str(), std::move(record));
+}
+
+bool IncrementalCache::save() const {
+  // Write to a temporary file first, so that a concurrent or interrupted run
+  //  never sees a partial cache.
+  auto temporaryPath = Path + ".tmp";
+  {
+    std::error_code error;
+    llvm::raw_fd_ostream out(temporaryPath, error);
+    if (error) {
+      return false;
+    }
+    out << cacheMagic << llvm::utohexstr(Seed) << "\n";
+    for (const auto &filePath : CurrentFileOrder) {
+      const auto &records = Current.find(filePath)->second;
+      out << "F " << llvm::utohexstr(records.front().second.position.contentHash)
+          << " " << filePath << "\n";
+      for (const auto &[declID, record] : records) {
+        out << "R " << llvm::utohexstr(record.position.prefixHash) << " "
+            << (record.isDefinition ? "1" : "0") << " "
+            << llvm::utohexstr(record.hash) << " " << declID.size() << " "
+            << declID << record.json << "\n";
+        for (const auto &[referencedID, hash] : record.references) {
+          out << "D " << (hash ? llvm::utohexstr(*hash) : "-") << " "
+              << referencedID << "\n";
+        }
+      }
+    }
+    if (out.has_error()) {
+      out.clear_error();
+      return false;
+    }
+  }
+  return !llvm::sys::fs::rename(temporaryPath, Path);
+}
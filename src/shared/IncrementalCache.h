@@ -0,0 +1,99 @@
+#include <clang/Basic/SourceLocation.h>
+#include <clang/Basic/SourceManager.h>
+#include <cstdint>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_INCREMENTAL_CACHE_H
+#define TYPE_EXTRACTOR_INCREMENTAL_CACHE_H
+
+// Where a declaration sits in the translation unit, for cache purposes.
+struct CachePosition {
+  // Hash of the contents of the file the declaration is in.
+  uint64_t contentHash;
+  // Hash of every file entered before the declaration in lexing order (i.e.
+  //  through `#include`s that come before it, including its own file and the
+  //  ones including it), which covers anything the declaration could depend
+  //  on.
+  uint64_t prefixHash;
+};
+
+// The declaration ID of a record that another one references, along with
+//  the hash it had when the other one was hashed (unset in cycles, where it
+//  hadn't been emitted yet).
+using CacheReference = std::pair<llvm::StringRef, std::optional<uint64_t>>;
+
+// An on-disk cache of the records emitted by a previous run, grouped by the
+//  file they were declared in. A cached record is only replayed if neither
+//  its file nor anything lexed before it has changed, and neither have the
+//  records it references (which its hash covers, and which may be declared
+//  later), which is what makes the output identical to that of a full run.
+class IncrementalCache {
+public:
+  struct Record {
+    CachePosition position;
+    bool isDefinition;
+    uint64_t hash;
+    std::vector<CacheReference> references;
+    std::string json;
+  };
+
+private:
+  std::string Path;
+  uint64_t Seed;
+  // Owns the declaration IDs of references.
+  llvm::BumpPtrAllocator Allocator;
+  llvm::StringSaver Saver{Allocator};
+  // A file entry of the TU, with the hashes at that point.
+  struct FileEntry {
+    clang::SourceLocation::UIntTy offset;
+    // Where the file was included from, which is invalid for the main file
+    //  and Clang's predefines.
+    clang::SourceLocation includeLoc;
+    CachePosition position;
+  };
+  // In the order they were entered, which is also the order of their offsets.
+  std::vector<FileEntry> Files;
+  // Records from the previous run, by declaration ID.
+  llvm::StringMap<Record> Previous;
+  // Records from this run, by file path (in order of first appearance).
+  std::vector<std::string> CurrentFileOrder;
+  llvm::StringMap<std::vector<std::pair<std::string, Record>>> Current;
+
+  void load();
+
+public:
+  // `seed` should identify everything besides file contents that affects the
+  //  output (i.e. the compiler version and invocation).
+  IncrementalCache(std::string path, uint64_t seed);
+
+  // Hash the files of the translation unit. Must be called before `locate`.
+  void indexTranslationUnit(const clang::SourceManager &SM);
+
+  CachePosition locate(const clang::SourceManager &SM,
+                       clang::SourceLocation expansionLoc) const;
+
+  // Get the cached record for the declaration, if it is still valid.
+  //  `getHash` gives the hash of a record emitted so far in this run.
+  const Record *
+  lookup(llvm::StringRef declID, const CachePosition &position,
+         llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)> getHash)
+      const;
+
+  // Remember a record emitted in this run.
+  void store(llvm::StringRef filePath, llvm::StringRef declID,
+             const CachePosition &position, bool isDefinition, uint64_t hash,
+             llvm::ArrayRef<CacheReference> references, llvm::StringRef json);
+
+  // Write this run's records out, replacing the previous cache.
+  bool save() const;
+};
+
+#endif // TYPE_EXTRACTOR_INCREMENTAL_CACHE_H
@@ -0,0 +1,122 @@
+#include "LayoutSweep.h"
+#include "json.h"
+#include <llvm/ADT/STLExtras.h>
+
+static bool sameType(const DeclIDAndTypeName &a, const DeclIDAndTypeName &b) {
+  return a.declID == b.declID && a.typeName == b.typeName;
+}
+
+static bool sameNamedTypes(llvm::ArrayRef<NamedType> a,
+                           llvm::ArrayRef<NamedType> b) {
+  return llvm::equal(a, b, [](const NamedType &x, const NamedType &y) {
+    return x.name == y.name && sameType(x.type, y.type);
+  });
+}
+
+// Whether the records are the same, apart from the offsets and sizes of
+//  their fields.
+static bool sameRecordIgnoringLayout(const TypeRecord &a, const TypeRecord &b) {
+  return a.kind == b.kind && sameType(a.type, b.type) &&
+         a.isDefinition == b.isDefinition && a.pseudoRoot == b.pseudoRoot &&
+         llvm::equal(a.location, b.location) &&
+         sameType(a.underlyingType, b.underlyingType) &&
+         llvm::equal(a.fields, b.fields,
+                     [](const StructField &x, const StructField &y) {
+                       return x.name == y.name && sameType(x.type, y.type);
+                     }) &&
+         sameNamedTypes(a.members, b.members) &&
+         sameType(a.backingType, b.backingType) &&
+         llvm::equal(a.entries, b.entries,
+                     [](const EnumEntry &x, const EnumEntry &y) {
+                       return x.name == y.name && x.value == y.value;
+                     }) &&
+         sameType(a.returnType, b.returnType) &&
+         sameNamedTypes(a.params, b.params);
+}
+
+// Whether records that are otherwise the same have the same field layouts.
+static bool sameLayout(const TypeRecord &a, const TypeRecord &b) {
+  return llvm::equal(a.fields, b.fields,
+                     [](const StructField &x, const StructField &y) {
+                       return x.offset == y.offset && x.size == y.size;
+                     });
+}
+
+void LayoutSweepMerger::TargetSink::handleRecord(const TypeRecord &record) {
+  Records.push_back(copyTypeRecord(record, Saver));
+}
+
+LayoutSweepMerger::LayoutSweepMerger(const std::vector<std::string> &triples) {
+  for (const auto &triple : triples) {
+    Targets.push_back(std::make_unique<TargetSink>(triple));
+  }
+}
+
+void LayoutSweepMerger::writeVariant(llvm::raw_ostream &OS,
+                                     const Variant &variant) {
+  llvm::json::OStream J(OS);
+  J.object([&] {
+    json_type_record_attributes(J, *variant.record, nullptr);
+    if (variant.targets.size() != Targets.size()) {
+      J.attributeArray("targets", [&] {
+        for (auto target : variant.targets) {
+          J.value(Targets[target]->Triple);
+        }
+      });
+    }
+    if (!variant.layouts.empty()) {
+      J.attributeObject("targetLayouts", [&] {
+        for (const auto &[target, record] : variant.layouts) {
+          J.attributeBegin(Targets[target]->Triple);
+          json_field_layouts(J, record->fields);
+          J.attributeEnd();
+        }
+      });
+    }
+    if (!variant.hashes.empty()) {
+      J.attributeObject("targetHashes", [&] {
+        for (const auto &[target, record] : variant.hashes) {
+          J.attribute(Targets[target]->Triple, json_hash(record->hash));
+        }
+      });
+    }
+  });
+  OS << "\n";
+}
+
+void LayoutSweepMerger::write(llvm::raw_ostream &OS) {
+  // Group the records of each type into variants, in target order.
+  llvm::StringMap<std::vector<Variant>> variants;
+  for (size_t target = 0; target < Targets.size(); ++target) {
+    for (const auto &record : Targets[target]->Records) {
+      auto &recordVariants = variants[*record.type.declID];
+      auto variant = llvm::find_if(recordVariants, [&](const Variant &v) {
+        return sameRecordIgnoringLayout(*v.record, record);
+      });
+      if (variant == recordVariants.end()) {
+        recordVariants.push_back({&record, {target}});
+        continue;
+      }
+      variant->targets.push_back(target);
+      if (!sameLayout(*variant->record, record)) {
+        variant->layouts.push_back({target, &record});
+      }
+      if (variant->record->hash != record.hash) {
+        variant->hashes.push_back({target, &record});
+      }
+    }
+  }
+
+  // Each variant is written while going through the records of its first
+  //  target, where everything it references has already been written.
+  for (size_t target = 0; target < Targets.size(); ++target) {
+    for (const auto &record : Targets[target]->Records) {
+      for (const auto &variant : variants[*record.type.declID]) {
+        if (variant.record == &record) {
+          writeVariant(OS, variant);
+        }
+      }
+    }
+  }
+  OS.flush();
+}
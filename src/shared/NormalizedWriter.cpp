@@ -0,0 +1,64 @@
+#include "NormalizedWriter.h"
+#include "json.h"
+#include <llvm/ADT/SmallString.h>
+
+uint64_t NormalizedWriter::internFile(const TypeRecord &record) {
+  // Path components can't contain a '/', so this is unambiguous.
+  llvm::SmallString<256> key(record.pseudoRoot);
+  for (const auto &component : record.location) {
+    key += '/';
+    key += component;
+  }
+  auto [it, inserted] = FileIDs.try_emplace(key, FileIDs.size());
+  if (inserted) {
+    json_file_table_entry(OS, it->second, record.pseudoRoot, record.location);
+    OS << "\n";
+  }
+  return it->second;
+}
+
+void NormalizedWriter::internTypeName(llvm::StringRef typeName) {
+  auto [it, inserted] = TypeNameIDs.try_emplace(typeName, TypeNameIDs.size());
+  if (inserted) {
+    json_type_name_table_entry(OS, it->second, typeName);
+    OS << "\n";
+  }
+}
+
+void NormalizedWriter::handleRecord(const TypeRecord &record) {
+  // Write out any new table entries first, as the record can't be interrupted
+  //  once it's being written.
+  uint64_t fileID = internFile(record);
+  internTypeName(record.type.typeName);
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    internTypeName(record.underlyingType.typeName);
+    break;
+  case TypeKind::Struct:
+    for (const auto &field : record.fields) {
+      internTypeName(field.type.typeName);
+    }
+    break;
+  case TypeKind::Union:
+    for (const auto &member : record.members) {
+      internTypeName(member.type.typeName);
+    }
+    break;
+  case TypeKind::Enum:
+    internTypeName(record.backingType.typeName);
+    break;
+  case TypeKind::Function:
+    internTypeName(record.returnType.typeName);
+    for (const auto &param : record.params) {
+      internTypeName(param.type.typeName);
+    }
+    break;
+  }
+
+  auto typeNameID = [&](llvm::StringRef typeName) {
+    return TypeNameIDs.find(typeName)->second;
+  };
+  JSONTableIDs tables = {typeNameID, fileID};
+  json_type_record(OS, record, &tables);
+  OS << "\n";
+}
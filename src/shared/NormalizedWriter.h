@@ -0,0 +1,35 @@
+#include "RecordSink.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/raw_ostream.h>
+
+#ifndef TYPE_EXTRACTOR_NORMALIZED_WRITER_H
+#define TYPE_EXTRACTOR_NORMALIZED_WRITER_H
+
+// Writes records as JSON lines like the default format, but with each file
+//  and each distinct type name written once as a table entry, and records
+//  referring to them by ID. Table entries are written just before the first
+//  record that refers to them, so the output can still be read in one pass.
+class NormalizedWriter : public RecordSink {
+private:
+  llvm::raw_ostream &OS;
+  uint64_t StartPosition;
+  llvm::StringMap<uint64_t> FileIDs;
+  llvm::StringMap<uint64_t> TypeNameIDs;
+
+  uint64_t internFile(const TypeRecord &record);
+  void internTypeName(llvm::StringRef typeName);
+
+public:
+  explicit NormalizedWriter(llvm::raw_ostream &OS)
+      : OS(OS), StartPosition(OS.tell()) {}
+
+  void handleRecord(const TypeRecord &record) override;
+
+  void finish() override { OS.flush(); }
+
+  uint64_t getBytesWritten() const override {
+    return OS.tell() - StartPosition;
+  }
+};
+
+#endif // TYPE_EXTRACTOR_NORMALIZED_WRITER_H
@@ -0,0 +1,62 @@
+#include "OutputDirectoryWriter.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+// The temporary name of each file, next to where it ends up.
+static constexpr llvm::StringLiteral temporarySuffix = ".tmp";
+
+static std::unique_ptr<llvm::raw_fd_ostream>
+openTemporary(llvm::StringRef path) {
+  std::error_code error;
+  auto stream = std::make_unique<llvm::raw_fd_ostream>(
+      (path + temporarySuffix).str(), error);
+  if (error) {
+    llvm::errs() << "te: can't write " << path << temporarySuffix << ": "
+                 << error.message() << "\n";
+    return nullptr;
+  }
+  return stream;
+}
+
+OutputDirectoryWriter::OutputDirectoryWriter(llvm::StringRef directory,
+                                             llvm::StringRef name) {
+  llvm::sys::fs::create_directories(directory);
+  llvm::SmallString<256> path(directory);
+  llvm::sys::path::append(path, name);
+  Path = path.str().str();
+  Definitions = openTemporary(Path + ".jsonl");
+  ForwardDeclarations =
+      openTemporary(Path + forwardDeclarationsExtension.str());
+}
+
+void OutputDirectoryWriter::handleSerializedRecord(
+    const EmittedRecord &record) {
+  auto &stream = record.isDefinition ? Definitions : ForwardDeclarations;
+  if (stream) {
+    *stream << record.json << "\n";
+    BytesWritten += record.json.size() + 1;
+  }
+}
+
+void OutputDirectoryWriter::finish() {
+  auto commit = [](std::unique_ptr<llvm::raw_fd_ostream> &stream,
+                   const std::string &path) {
+    if (!stream) {
+      return;
+    }
+    stream->close();
+    std::string temporaryPath = path + temporarySuffix.str();
+    if (stream->has_error()) {
+      stream->clear_error();
+      llvm::errs() << "te: can't write " << temporaryPath << "\n";
+      llvm::sys::fs::remove(temporaryPath);
+    } else if (auto error = llvm::sys::fs::rename(temporaryPath, path)) {
+      llvm::errs() << "te: can't write " << path << ": " << error.message()
+                   << "\n";
+    }
+    stream.reset();
+  };
+  commit(Definitions, Path + ".jsonl");
+  commit(ForwardDeclarations, Path + forwardDeclarationsExtension.str());
+}
@@ -0,0 +1,126 @@
+#include "ParallelSerializer.h"
+#include "json.h"
+#include <chrono>
+#include <llvm/Support/raw_ostream.h>
+
+// Records per batch, which is enough to keep the overhead of handing out
+//  batches small, without waiting too long for the first one.
+static constexpr size_t batchSize = 1024;
+
+ParallelSerializer::ParallelSerializer(SerializedRecordSink &sink,
+                                       IncrementalCache *cache,
+                                       unsigned threadCount)
+    : Sink(sink), Cache(cache),
+      Pool(llvm::hardware_concurrency(threadCount)),
+      Current(std::make_unique<Batch>()) {}
+
+ParallelSerializer::~ParallelSerializer() { Pool.wait(); }
+
+// Copy the references into the current batch.
+llvm::ArrayRef<CacheReference>
+ParallelSerializer::copyReferences(llvm::ArrayRef<CacheReference> references) {
+  if (!Cache || references.empty()) {
+    return {};
+  }
+  auto copy = Current->Allocator.Allocate<CacheReference>(references.size());
+  for (size_t i = 0; i < references.size(); ++i) {
+    new (&copy[i]) CacheReference(Current->Saver.save(references[i].first),
+                                  references[i].second);
+  }
+  return {copy, references.size()};
+}
+
+void ParallelSerializer::add(const TypeRecord &record,
+                             llvm::StringRef filePath,
+                             const CachePosition &cachePosition,
+                             llvm::ArrayRef<CacheReference> references) {
+  auto &saver = Current->Saver;
+  Current->Items.push_back({copyTypeRecord(record, saver), {},
+                            saver.save(filePath), cachePosition,
+                            copyReferences(references)});
+  if (Current->Items.size() == batchSize) {
+    submit();
+  }
+}
+
+void ParallelSerializer::addSerialized(
+    const EmittedRecord &record, uint64_t hash, llvm::StringRef filePath,
+    const CachePosition &cachePosition,
+    llvm::ArrayRef<CacheReference> references) {
+  auto &saver = Current->Saver;
+  TypeRecord copy;
+  copy.type.declID = saver.save(record.declID);
+  copy.isDefinition = record.isDefinition;
+  copy.hash = hash;
+  Current->Items.push_back({std::move(copy), saver.save(record.json),
+                            saver.save(filePath), cachePosition,
+                            copyReferences(references)});
+  if (Current->Items.size() == batchSize) {
+    submit();
+  }
+}
+
+void ParallelSerializer::submit() {
+  auto batch = std::move(Current);
+  Current = std::make_unique<Batch>();
+  Batch *pending = batch.get();
+  pending->Done = Pool.async([pending] {
+    llvm::raw_string_ostream OS(pending->Output);
+    for (const auto &item : pending->Items) {
+      if (item.json.empty()) {
+        json_type_record(OS, item.record);
+        OS.flush();
+        pending->OutputEnds.push_back(pending->Output.size());
+      }
+    }
+  });
+  InFlight.push_back(std::move(batch));
+  // Keep a bounded number of batches around, so memory doesn't grow with
+  //  the size of the translation unit when the workers can't keep up.
+  emitFinished(InFlight.size() > 2 * Pool.getMaxConcurrency());
+}
+
+// Emit the batches at the front that are done, and if `wait` is set, at
+//  least the oldest one.
+void ParallelSerializer::emitFinished(bool wait) {
+  while (!InFlight.empty()) {
+    auto &done = InFlight.front()->Done;
+    if (!wait && done.wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready) {
+      return;
+    }
+    done.wait();
+    emit(*InFlight.front());
+    InFlight.pop_front();
+    wait = false;
+  }
+}
+
+void ParallelSerializer::emit(Batch &batch) {
+  size_t outputIndex = 0;
+  size_t start = 0;
+  for (const auto &item : batch.Items) {
+    llvm::StringRef json = item.json;
+    if (json.empty()) {
+      size_t end = batch.OutputEnds[outputIndex++];
+      json = llvm::StringRef(batch.Output).slice(start, end);
+      start = end;
+    }
+    const auto &declID = *item.record.type.declID;
+    if (Cache) {
+      Cache->store(item.filePath, declID, item.cachePosition,
+                   item.record.isDefinition, item.record.hash,
+                   item.references, json);
+    }
+    Sink.handleSerializedRecord({declID, item.record.isDefinition, json});
+  }
+}
+
+void ParallelSerializer::finish() {
+  if (!Current->Items.empty()) {
+    submit();
+  }
+  while (!InFlight.empty()) {
+    emitFinished(true);
+  }
+}
@@ -0,0 +1,78 @@
+#include "IncrementalCache.h"
+#include "RecordSink.h"
+#include "TypeRecord.h"
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/ThreadPool.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_PARALLEL_SERIALIZER_H
+#define TYPE_EXTRACTOR_PARALLEL_SERIALIZER_H
+
+// Serializes records to JSON on a pool of threads while the extraction goes
+//  on, and hands them to the sink (and incremental cache, if any) in the
+//  order they were added. Records are copied in batches, so all the AST
+//  queries stay on the extraction thread, which is also the only one that
+//  touches the sink and the cache.
+class ParallelSerializer {
+private:
+  struct Item {
+    TypeRecord record;
+    // Set for records that are already serialized, e.g. replayed ones.
+    llvm::StringRef json;
+    llvm::StringRef filePath;
+    CachePosition cachePosition;
+    llvm::ArrayRef<CacheReference> references;
+  };
+
+  struct Batch {
+    llvm::BumpPtrAllocator Allocator;
+    llvm::StringSaver Saver{Allocator};
+    std::vector<Item> Items;
+    // The JSON of the items that weren't serialized already, back to back,
+    //  with where each one ends.
+    std::string Output;
+    std::vector<size_t> OutputEnds;
+    std::shared_future<void> Done;
+  };
+
+  SerializedRecordSink &Sink;
+  IncrementalCache *Cache;
+  llvm::DefaultThreadPool Pool;
+  std::unique_ptr<Batch> Current;
+  // Batches being serialized, oldest first.
+  std::deque<std::unique_ptr<Batch>> InFlight;
+
+  llvm::ArrayRef<CacheReference>
+  copyReferences(llvm::ArrayRef<CacheReference> references);
+  void submit();
+  void emit(Batch &batch);
+  void emitFinished(bool wait);
+
+public:
+  // With a `threadCount` of 0, there's one thread per core.
+  ParallelSerializer(SerializedRecordSink &sink, IncrementalCache *cache,
+                     unsigned threadCount);
+  ~ParallelSerializer();
+
+  // Queue a record, which is copied. `filePath`, `cachePosition` and
+  //  `references` are only used for the incremental cache.
+  void add(const TypeRecord &record, llvm::StringRef filePath,
+           const CachePosition &cachePosition,
+           llvm::ArrayRef<CacheReference> references);
+  // Queue a record that's already serialized.
+  void addSerialized(const EmittedRecord &record, uint64_t hash,
+                     llvm::StringRef filePath,
+                     const CachePosition &cachePosition,
+                     llvm::ArrayRef<CacheReference> references);
+
+  // Hand every record added so far to the sink.
+  void finish();
+};
+
+#endif // TYPE_EXTRACTOR_PARALLEL_SERIALIZER_H
@@ -0,0 +1,19 @@
+#include "RecordSink.h"
+#include "json.h"
+#include <llvm/Support/raw_ostream.h>
+
+void SerializedRecordSink::handleRecord(const TypeRecord &record) {
+  Scratch.clear();
+  llvm::raw_string_ostream OS(Scratch);
+  json_type_record(OS, record);
+  handleSerializedRecord({*record.type.declID, record.isDefinition, Scratch});
+}
+
+void JSONStreamSink::handleRecord(const TypeRecord &record) {
+  json_type_record(OS, record);
+  OS << "\n";
+}
+
+void JSONStreamSink::handleSerializedRecord(const EmittedRecord &record) {
+  OS << record.json << "\n";
+}
@@ -0,0 +1,151 @@
+#include "ShardedWriter.h"
+#include "json.h"
+#include <cstring>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/OnDiskHashTable.h>
+#include <llvm/Support/Path.h>
+
+std::optional<uint32_t>
+ShardedWriter::getShard(llvm::StringRef pseudoRoot,
+                        llvm::ArrayRef<llvm::StringRef> location) {
+  // Frameworks are usually nested a few directories deep, but they're what
+  //  consumers of an SDK look for.
+  llvm::StringRef component;
+  if (!location.empty()) {
+    component = location.front();
+  }
+  for (auto framework : location) {
+    if (framework.ends_with(".framework")) {
+      component = framework;
+      break;
+    }
+  }
+  llvm::SmallString<128> name(pseudoRoot);
+  if (!component.empty() && component != "." && component != "..") {
+    name += "/";
+    name += component;
+  }
+
+  auto [it, inserted] = ShardIDs.try_emplace(name);
+  if (!inserted) {
+    return it->second;
+  }
+  llvm::SmallString<256> path(Directory);
+  llvm::sys::path::append(path, name);
+  path += shardFileExtension;
+  std::error_code error = llvm::sys::fs::create_directories(
+      llvm::sys::path::parent_path(path));
+  auto stream = std::make_unique<llvm::raw_fd_ostream>(path, error);
+  if (error) {
+    llvm::errs() << "te: can't write " << path << ": " << error.message()
+                 << "\n";
+    Failed = true;
+    return std::nullopt;
+  }
+  it->second = Shards.size();
+  ShardNames.push_back(name.str().str());
+  Shards.push_back(std::move(stream));
+  return it->second;
+}
+
+void ShardedWriter::write(std::optional<uint32_t> shard,
+                          llvm::StringRef declID, llvm::StringRef typeName,
+                          llvm::StringRef json) {
+  if (!shard) {
+    return;
+  }
+  auto &OS = *Shards[*shard];
+  ShardLocation location = {*shard, uint32_t(json.size()), OS.tell()};
+  OS << json << "\n";
+  BytesWritten += json.size() + 1;
+  Locations[shardIndexIDKey(declID)].push_back(location);
+  // Anonymous records can only be found through the records using them.
+  if (!typeName.empty()) {
+    Locations[shardIndexNameKey(typeName)].push_back(location);
+  }
+}
+
+void ShardedWriter::handleRecord(const TypeRecord &record) {
+  Scratch.clear();
+  llvm::raw_string_ostream OS(Scratch);
+  json_type_record(OS, record);
+  write(getShard(record.pseudoRoot, record.location), *record.type.declID,
+        record.type.typeName, Scratch);
+}
+
+void ShardedWriter::handleSerializedRecord(const EmittedRecord &record) {
+  auto value = llvm::json::parse(record.json);
+  auto object = value ? value->getAsObject() : nullptr;
+  if (!object) {
+    if (!value) {
+      llvm::consumeError(value.takeError());
+    }
+    llvm::errs() << "te: can't shard record " << record.declID << "\n";
+    Failed = true;
+    return;
+  }
+  llvm::SmallVector<llvm::StringRef, 16> location;
+  if (auto components = object->getArray("location")) {
+    for (const auto &component : *components) {
+      location.push_back(component.getAsString().value_or(""));
+    }
+  }
+  llvm::StringRef typeName;
+  if (auto type = object->getObject("type")) {
+    typeName = type->getString("typeName").value_or("");
+  }
+  write(getShard(object->getString("pseudoRoot").value_or(""), location),
+        record.declID, typeName, record.json);
+}
+
+bool ShardedWriter::writeIndex() {
+  llvm::SmallString<256> path(Directory);
+  llvm::sys::path::append(path, shardIndexFileName);
+  std::error_code error = llvm::sys::fs::create_directories(Directory);
+  llvm::raw_fd_ostream OS(path, error);
+  if (error) {
+    llvm::errs() << "te: can't write " << path << ": " << error.message()
+                 << "\n";
+    return false;
+  }
+
+  // The header comes first, so that no bucket starts at offset 0 (which
+  //  marks an empty one). It's rewritten once the table's offset is known.
+  ShardIndexHeader header = {};
+  std::memcpy(header.magic, shardIndexMagic, sizeof(shardIndexMagic));
+  header.version = shardIndexVersion;
+  header.shardCount = ShardNames.size();
+  header.shardNamesOffset = sizeof(header);
+  OS.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const auto &name : ShardNames) {
+    OS << name << '\0';
+  }
+
+  llvm::OnDiskChainedHashTableGenerator<ShardIndexWriterInfo> generator;
+  for (const auto &entry : Locations) {
+    generator.insert(entry.getKey().str(), entry.getValue());
+  }
+  header.tableOffset = generator.Emit(OS);
+  OS.seek(0);
+  OS.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  OS.close();
+  bool failed = OS.has_error();
+  OS.clear_error();
+  return !failed;
+}
+
+void ShardedWriter::finish() {
+  for (auto &shard : Shards) {
+    shard->flush();
+    if (shard->has_error()) {
+      shard->clear_error();
+      Failed = true;
+    }
+  }
+  if (Failed || !writeIndex()) {
+    llvm::errs() << "te: the sharded output in " << Directory
+                 << " is incomplete\n";
+  }
+}
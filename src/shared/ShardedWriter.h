@@ -0,0 +1,54 @@
+#include "RecordSink.h"
+#include "ShardIndex.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_SHARDED_WRITER_H
+#define TYPE_EXTRACTOR_SHARDED_WRITER_H
+
+// Writes records as JSON lines like the default format, split into one file
+//  per shard in a directory, along with an index of where each record is (see
+//  `ShardIndex.h`). A record's shard is its pseudo-root and the top-level
+//  directory it's declared in (or its framework, for framework headers), so
+//  that the types of one part of an SDK end up together.
+class ShardedWriter : public SerializedRecordSink {
+private:
+  std::string Directory;
+  // Shards that couldn't be created have no ID.
+  llvm::StringMap<std::optional<uint32_t>> ShardIDs;
+  std::vector<std::string> ShardNames;
+  std::vector<std::unique_ptr<llvm::raw_fd_ostream>> Shards;
+  // Locations of the records, by index key (in the order they were written).
+  llvm::StringMap<llvm::SmallVector<ShardLocation, 1>> Locations;
+  std::string Scratch;
+  uint64_t BytesWritten = 0;
+  bool Failed = false;
+
+  std::optional<uint32_t> getShard(llvm::StringRef pseudoRoot,
+                                   llvm::ArrayRef<llvm::StringRef> location);
+  void write(std::optional<uint32_t> shard, llvm::StringRef declID,
+             llvm::StringRef typeName, llvm::StringRef json);
+  bool writeIndex();
+
+public:
+  explicit ShardedWriter(std::string directory)
+      : Directory(std::move(directory)) {}
+
+  void handleRecord(const TypeRecord &record) override;
+
+  // Records that are already serialized are parsed for their location and
+  //  name, which is only the case for replayed (or parallel-serialized) ones.
+  void handleSerializedRecord(const EmittedRecord &record) override;
+
+  // Write the index. Shards are only complete once it's written.
+  void finish() override;
+
+  uint64_t getBytesWritten() const override { return BytesWritten; }
+};
+
+#endif // TYPE_EXTRACTOR_SHARDED_WRITER_H
@@ -0,0 +1,44 @@
+#include "TypeCache.h"
+#include "util.h"
+
+// Reference a type from a record. Records are referred to by their name.
+static DeclIDAndTypeName referenceType(const clang::QualType &QT,
+                                       llvm::StringSaver &saver) {
+  auto reference = typeToDeclIDAndTypeName(QT, saver);
+  if (auto RD = QT->getAsRecordDecl()) {
+    // If the type is an anonymous struct or union, we use an empty name.
+    reference.typeName =
+        RD->isAnonymousStructOrUnion() ? "" : getDeclName(RD, saver);
+  }
+  return reference;
+}
+
+const DeclIDAndTypeName &TypeCache::reference(clang::QualType QT) {
+  ++Stats.typeCacheLookups;
+  auto &entry = Entries[QT.getAsOpaquePtr()];
+  if (entry.reference) {
+    ++Stats.typeCacheHits;
+  } else {
+    PhaseTimer timer(PhaseStats, ExtractionPhase::TypeNames);
+    entry.reference = referenceType(QT, Saver);
+  }
+  return *entry.reference;
+}
+
+const clang::TypeInfo &TypeCache::info(const clang::ASTContext &context,
+                                       clang::QualType QT) {
+  ++Stats.typeCacheLookups;
+  auto &entry = Entries[QT.getAsOpaquePtr()];
+  if (entry.info) {
+    ++Stats.typeCacheHits;
+  } else {
+    PhaseTimer timer(PhaseStats, ExtractionPhase::Layout);
+    entry.info = context.getTypeInfo(QT);
+  }
+  return *entry.info;
+}
+
+void TypeCache::clear() {
+  Entries.clear();
+  Allocator.Reset();
+}
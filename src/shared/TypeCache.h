@@ -0,0 +1,47 @@
+#include "ExtractionStats.h"
+#include "TypeRecord.h"
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Type.h>
+#include <cstdint>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <optional>
+
+#ifndef TYPE_EXTRACTOR_TYPE_CACHE_H
+#define TYPE_EXTRACTOR_TYPE_CACHE_H
+
+// Memoizes how types are referenced from records and how big they are, as
+//  headers tend to use the same few types (`uint32_t`, `id`, ...) over and
+//  over. Entries are keyed on the `QualType` as written, sugar included,
+//  since that's what the spelling depends on. Only valid for one AST, so it
+//  has to be cleared between translation units.
+class TypeCache {
+private:
+  struct Entry {
+    std::optional<DeclIDAndTypeName> reference;
+    std::optional<clang::TypeInfo> info;
+  };
+
+  llvm::DenseMap<void *, Entry> Entries;
+  // Owns the strings of the cached references.
+  llvm::BumpPtrAllocator Allocator;
+  llvm::StringSaver Saver{Allocator};
+  ExtractionStats &Stats;
+  // Where phases are timed, if anywhere.
+  ExtractionStats *PhaseStats;
+
+public:
+  TypeCache(ExtractionStats &stats, ExtractionStats *phaseStats)
+      : Stats(stats), PhaseStats(phaseStats) {}
+
+  // How a record refers to the type. The strings live until `clear`.
+  const DeclIDAndTypeName &reference(clang::QualType QT);
+  // The size and alignment of the type.
+  const clang::TypeInfo &info(const clang::ASTContext &context,
+                              clang::QualType QT);
+
+  void clear();
+};
+
+#endif // TYPE_EXTRACTOR_TYPE_CACHE_H
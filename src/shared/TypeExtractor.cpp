@@ -1,8 +1,28 @@
-#include "TypeExtractorAction.h"
+#include "TypeExtractorSession.h"
+#include "BinaryWriter.h"
+#include "DedupStore.h"
+#include "FrontendProfile.h"
+#include "IncrementalCache.h"
+#include "NormalizedWriter.h"
+#include "OutputDirectoryWriter.h"
+#include "ParallelSerializer.h"
+#include "ShardedWriter.h"
+#include "TypeCache.h"
 #include "json.h"
 #include "util.h"
 #include <clang/AST/RecordLayout.h>
 #include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/Version.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/xxhash.h>
+#include <map>
 #include <vector>
 
 // No Windows support yet.
@@ -10,10 +30,8 @@
 #error "Windows support is not implemented yet."
 #endif
 
-llvm::StringRef getDeclFilePath(clang::Decl *D) {
-  clang::SourceLocation loc = D->getLocation();
-  clang::SourceManager &SM = D->getASTContext().getSourceManager();
-  clang::SourceLocation expansionLoc = SM.getExpansionLoc(loc);
+llvm::StringRef getFilePath(const clang::SourceManager &SM,
+                            clang::SourceLocation expansionLoc) {
   llvm::StringRef filePath = SM.getFilename(expansionLoc);
   if (llvm::sys::path::is_relative(filePath)) {
     const clang::FileEntry *FE =
@@ -27,8 +45,10 @@ llvm::StringRef getDeclFilePath(clang::Decl *D) {
   return filePath;
 }
 
-static llvm::StringRef sysroot;
-static llvm::StringRef resourceDir;
+llvm::StringRef getDeclFilePath(clang::Decl *D) {
+  clang::SourceManager &SM = D->getASTContext().getSourceManager();
+  return getFilePath(SM, SM.getExpansionLoc(D->getLocation()));
+}
 
 enum class FileRoot { Sysroot, ResourceDir, Unknown };
 
@@ -47,7 +67,8 @@ llvm::StringRef fileRootToPseudoRoot(FileRoot root) {
 }
 
 std::pair<FileRoot, llvm::StringRef>
-getRelativeFilePathIfRelevant(llvm::StringRef filePath) {
+getRelativeFilePathIfRelevant(llvm::StringRef filePath, llvm::StringRef sysroot,
+                              llvm::StringRef resourceDir) {
   if (filePath.starts_with(sysroot)) {
     return std::make_pair(FileRoot::Sysroot,
                           filePath.drop_front(sysroot.size()));
@@ -59,205 +80,643 @@ getRelativeFilePathIfRelevant(llvm::StringRef filePath) {
   return std::make_pair(FileRoot::Unknown, filePath);
 }
 
-std::map<llvm::StringRef, std::vector<std::string>> pathComponentsMap;
-std::set<std::string> processedDeclIDs;
-
-bool emitTypeDecl(clang::NamedDecl *D, bool parseAnyway = false) {
-  auto preEmitIfRecordDecl = [](clang::QualType &QT,
-                                DeclIDAndTypeName &declIDAndTypeName) {
-    if (auto RD = QT->getAsRecordDecl()) {
-      // Ensure the record type is emitted before other types that reference it.
-      emitTypeDecl(RD, true);
-      // If the type is an anonymous struct or union, we use an empty name.
-      declIDAndTypeName.second =
-          RD->isAnonymousStructOrUnion() ? "" : RD->getNameAsString();
+// Emit a record, remembering it in the incremental cache if there is one.
+void TypeExtractorSession::emitRecord(const TypeRecord &record,
+                                      llvm::StringRef filePath,
+                                      const CachePosition &cachePosition) {
+  if (Serializer) {
+    Serializer->add(record, filePath, cachePosition, RecordReferences);
+    return;
+  }
+  if (!Cache) {
+    Sink.handleRecord(record);
+    return;
+  }
+  RecordJSON.clear();
+  llvm::raw_svector_ostream OS(RecordJSON);
+  json_type_record(OS, record);
+  Cache->store(filePath, *record.type.declID, cachePosition,
+               record.isDefinition, record.hash, RecordReferences, RecordJSON);
+  Sink.asSerializedRecordSink()->handleSerializedRecord(
+      {*record.type.declID, record.isDefinition, RecordJSON});
+}
+
+// Get the path components of a (pseudo-root relative) file path, caching them.
+llvm::ArrayRef<llvm::StringRef>
+TypeExtractorSession::getPathComponents(llvm::StringRef filePath) {
+  auto [it, inserted] = PathComponents.try_emplace(filePath);
+  ++Stats.pathLookups;
+  if (!inserted) {
+    ++Stats.pathHits;
+  } else {
+    // Remove the root path.
+    auto relativePath =
+        filePath.drop_front(llvm::sys::path::root_path(filePath).size());
+    // Get the components of the file path, ignoring empty components.
+    for (llvm::StringRef component :
+         llvm::make_range(llvm::sys::path::begin(relativePath),
+                          llvm::sys::path::end(relativePath))) {
+      if (!component.empty()) {
+        it->second.push_back(component);
+      }
     }
+  }
+  return it->second;
+}
+
+// Check a file against the filters, caching the result.
+bool TypeExtractorSession::isFileIncluded(const clang::SourceManager &SM,
+                                          clang::FileID file) {
+  auto [it, inserted] = FilteredFiles.try_emplace(file, true);
+  if (!inserted) {
+    return it->second;
+  }
+  const auto &filters = Options.filters;
+  auto filePath = getFilePath(SM, SM.getLocForStartOfFile(file));
+  auto pseudoRoot = fileRootToPseudoRoot(
+      getRelativeFilePathIfRelevant(filePath, Sysroot, ResourceDir).first);
+  auto matchesAny = [&](const std::vector<llvm::GlobPattern> &patterns,
+                        const std::vector<std::string> &pseudoRoots) {
+    auto matches = [&](const auto &glob) { return glob.match(filePath); };
+    return llvm::any_of(patterns, matches) ||
+           llvm::is_contained(pseudoRoots, pseudoRoot);
   };
+  bool hasIncludes =
+      !IncludePaths.empty() || !filters.includePseudoRoots.empty();
+  it->second =
+      (!hasIncludes || matchesAny(IncludePaths, filters.includePseudoRoots)) &&
+      !matchesAny(ExcludePaths, filters.excludePseudoRoots);
+  return it->second;
+}
 
-  // Skip if the declaration is not valid or should not be parsed.
-  if ((!D || !shouldParseDecl(D)) && !parseAnyway) {
-    return true; // Ignore invalid or unparseable declarations
+// Whether another output sharing the dedup store has claimed the record.
+//  Only definitions are claimed, so that one is always written somewhere,
+//  and TU-local fallback IDs never are, as they aren't the same type across
+//  translation units.
+bool TypeExtractorSession::isClaimedElsewhere(llvm::StringRef declID,
+                                              bool isDefinition) {
+  if (!Dedup || !isDefinition || declID.starts_with("#") ||
+      Dedup->claim(declID, DedupOwner)) {
+    return false;
   }
+  ++Stats.sharedDedupHits;
+  return true;
+}
 
-  // == Common setup for all declarations ==
+void TypeExtractorSession::setOutputName(llvm::StringRef outputName) {
+  DedupOwner = llvm::xxh3_64bits(llvm::arrayRefFromStringRef(outputName));
+}
 
-  // Get the declaration ID and type name.
-  auto declIDAsString = std::to_string(D->getID());
-  if (processedDeclIDs.contains(declIDAsString)) {
-    return true; // Skip if we've already processed this declaration ID.
+// Decide whether to traverse a declaration (and everything inside it).
+bool TypeExtractorSession::shouldTraverseDecl(clang::Decl *D) {
+  if (Options.filters.empty() || !D) {
+    return true;
   }
-  processedDeclIDs.insert(declIDAsString);
-  auto name = D->getNameAsString();
-  DeclIDAndTypeName currentDeclIDAndTypeName = {
-      std::make_optional(declIDAsString), name};
-
-  // Handle the file path and ensure it's absolute.
-  auto absoluteFilePath = getDeclFilePath(D);
-  if (!llvm::sys::path::is_absolute(absoluteFilePath)) {
-    return true; // Somehow we got a relative path, skip it.
+  // These can span several files through `#include`s inside them, so their
+  //  contents are checked individually instead.
+  if (llvm::isa<clang::TranslationUnitDecl, clang::LinkageSpecDecl,
+                clang::NamespaceDecl, clang::ExportDecl>(D)) {
+    return true;
+  }
+  auto &SM = D->getASTContext().getSourceManager();
+  auto expansionLoc = SM.getExpansionLoc(D->getLocation());
+  if (expansionLoc.isInvalid() ||
+      isFileIncluded(SM, SM.getFileID(expansionLoc))) {
+    return true;
   }
-  auto [fileRoot, filePath] = getRelativeFilePathIfRelevant(absoluteFilePath);
-  auto pseudoRoot = fileRootToPseudoRoot(fileRoot).str();
+  ++Stats.skippedDecls;
+  return false;
+}
 
-  // Get the file path components, caching them if necessary.
-  std::vector<std::string> filePathComponents;
-  if (pathComponentsMap.contains(filePath)) {
-    // Use cached components if available.
-    filePathComponents = pathComponentsMap[filePath];
-  } else {
-    // Get the file path and determine its root.
-    // Remove the root path.
-    filePath = filePath.drop_front(llvm::sys::path::root_path(filePath).size());
-    // Get the components of the file path, ignoring empty components.
-    for (llvm::StringRef component :
-         llvm::make_range(llvm::sys::path::begin(filePath),
-                          llvm::sys::path::end(filePath))) {
-      if (!component.empty()) {
-        filePathComponents.push_back(component.str());
+// The declaration of a type that a record references, and whether it
+//  references it by value (rather than through a pointer).
+struct Dependency {
+  clang::NamedDecl *decl;
+  bool byValue;
+};
+
+// Get the declarations of the types that `D`'s record references, which are
+//  emitted before it.
+void getDependencies(clang::NamedDecl *D,
+                     llvm::SmallVectorImpl<Dependency> &dependencies) {
+  auto addDependencies = [&](const clang::QualType &QT) {
+    forEachReferencedDecl(QT, [&](clang::NamedDecl *referenced, bool byValue) {
+      dependencies.push_back({referenced, byValue});
+    });
+  };
+  if (auto TD = llvm::dyn_cast<clang::TypedefNameDecl>(D)) {
+    addDependencies(TD->getUnderlyingType());
+  } else if (auto RD = llvm::dyn_cast<clang::RecordDecl>(D)) {
+    if (RD->isCompleteDefinition() && (RD->isUnion() || RD->isStruct())) {
+      for (const auto *field : RD->fields()) {
+        addDependencies(field->getType());
       }
     }
-    // Cache the components for future use.
-    pathComponentsMap[filePath] = filePathComponents;
+  } else if (auto ED = llvm::dyn_cast<clang::EnumDecl>(D)) {
+    addDependencies(ED->getIntegerType());
+  } else if (auto FD = llvm::dyn_cast<clang::FunctionDecl>(D)) {
+    addDependencies(FD->getReturnType());
+    for (const auto *param : FD->parameters()) {
+      addDependencies(param->getType());
+    }
   }
+}
 
-  // == Kind-specific declaration handling ==
+// Fill in the kind-specific parts of the record. Returns false if the
+//  declaration isn't of a kind we emit. Phases are timed into `stats`, if set.
+bool buildTypeRecord(clang::NamedDecl *D, TypeRecord &record,
+                     llvm::StringSaver &saver, TypeCache &types,
+                     ExtractionStats *stats) {
+  auto reference = [&](const clang::QualType &QT) {
+    return types.reference(QT);
+  };
 
-  // Typedef declaration handling.
-  if (auto TD = llvm::dyn_cast<clang::TypedefDecl>(D)) {
-    auto underlyingType = TD->getUnderlyingType();
-    DeclIDAndTypeName underlyingDeclIDAndTypeName =
-        typeToDeclIDAndTypeName(underlyingType);
-    preEmitIfRecordDecl(underlyingType, underlyingDeclIDAndTypeName);
-
-    auto typeName = underlyingType.getAsString();
-    auto json =
-        json_typdef_decl(currentDeclIDAndTypeName, underlyingDeclIDAndTypeName,
-                         pseudoRoot, filePathComponents);
-    llvm::outs() << json << "\n";
+  // Typedef (and `using` alias) declaration handling.
+  if (auto TD = llvm::dyn_cast<clang::TypedefNameDecl>(D)) {
+    record.kind = TypeKind::Typedef;
+    record.underlyingType = reference(TD->getUnderlyingType());
     return true;
   }
 
   // Record declaration handling.
   else if (auto RD = llvm::dyn_cast<clang::RecordDecl>(D)) {
-    auto isUnion = RD->isUnion();
-    auto isStruct = RD->isStruct();
     if (!RD->isCompleteDefinition()) {
       // Emit empty struct for forward declarations.
-      std::vector<std::pair<std::string, StructField>> emptyFields;
-      auto json = json_struct_decl(currentDeclIDAndTypeName, emptyFields,
-                                   pseudoRoot, filePathComponents);
-      llvm::outs() << json << "\n";
+      record.kind = TypeKind::Struct;
+      record.isDefinition = false;
       return true;
     }
-    if (!isUnion && !isStruct) {
-      // Not a union or struct, skip.
-      return true; // Ignore non-union/struct record declarations.
+    if (!RD->isUnion() && !RD->isStruct()) {
+      return false; // Ignore non-union/struct record declarations.
     }
 
-    currentDeclIDAndTypeName.second =
-        RD->isAnonymousStructOrUnion() ? "" : RD->getNameAsString();
-    ;
+    // If the type is an anonymous struct or union, we use an empty name.
+    if (RD->isAnonymousStructOrUnion()) {
+      record.type.typeName = "";
+    }
 
-    if (isUnion) {
+    if (RD->isUnion()) {
       // Ordering doesn't really matter for unions, but nice to have.
-      OrderedTypesMap fields;
+      record.kind = TypeKind::Union;
       for (const auto *field : RD->fields()) {
-        auto fieldType = field->getType();
-        auto fieldDeclIDAndTypeName = typeToDeclIDAndTypeName(fieldType);
-        preEmitIfRecordDecl(fieldType, fieldDeclIDAndTypeName);
-        fields.emplace_back(field->getNameAsString(), fieldDeclIDAndTypeName);
+        record.members.push_back(
+            {getDeclName(field, saver), reference(field->getType())});
       }
-      auto json = json_union_decl(currentDeclIDAndTypeName, fields, pseudoRoot,
-                                  filePathComponents);
-      llvm::outs() << json << "\n";
-
     } else {
-      std::vector<std::pair<std::string, StructField>> fields;
-      const auto &layout = RD->getASTContext().getASTRecordLayout(RD);
+      record.kind = TypeKind::Struct;
+      auto &context = RD->getASTContext();
+      const auto &layout = [&]() -> const clang::ASTRecordLayout & {
+        PhaseTimer timer(stats, ExtractionPhase::Layout);
+        return context.getASTRecordLayout(RD);
+      }();
       for (const auto *field : RD->fields()) {
-        auto fieldOffset = layout.getFieldOffset(field->getFieldIndex());
         auto fieldType = field->getType();
-        auto fieldDeclIDAndTypeName = typeToDeclIDAndTypeName(fieldType);
-        preEmitIfRecordDecl(fieldType, fieldDeclIDAndTypeName);
-        auto [fieldSize, _, __] = RD->getASTContext().getTypeInfo(fieldType);
-        StructField fieldStruct = {fieldOffset, fieldSize,
-                                   fieldDeclIDAndTypeName};
-        fields.emplace_back(field->getNameAsString(), fieldStruct);
+        int64_t fieldOffset = layout.getFieldOffset(field->getFieldIndex());
+        int64_t fieldSize = types.info(context, fieldType).Width;
+        record.fields.push_back({getDeclName(field, saver), fieldOffset,
+                                 fieldSize, reference(fieldType)});
       }
-      auto json = json_struct_decl(currentDeclIDAndTypeName, fields, pseudoRoot,
-                                   filePathComponents);
-      llvm::outs() << json << "\n";
     }
-
     return true;
   }
 
   // Enum declaration handling.
   else if (auto ED = llvm::dyn_cast<clang::EnumDecl>(D)) {
-    auto name = ED->getNameAsString();
-    auto backingType = ED->getIntegerType();
-    std::vector<std::pair<std::string, uint64_t>> entries;
+    record.kind = TypeKind::Enum;
+    // The integer type is never a record, so it's referenced like any other.
+    record.backingType = reference(ED->getIntegerType());
     for (const auto *enumerator : ED->enumerators()) {
-      entries.emplace_back(enumerator->getNameAsString(),
-                           enumerator->getInitVal().getZExtValue());
+      record.entries.push_back({getDeclName(enumerator, saver),
+                                enumerator->getInitVal().getZExtValue()});
     }
-    auto json = json_enum_decl(currentDeclIDAndTypeName,
-                               typeToDeclIDAndTypeName(backingType), entries,
-                               pseudoRoot, filePathComponents);
-    llvm::outs() << json << "\n";
     return true;
   }
 
   // Function declaration handling.
   else if (auto FD = llvm::dyn_cast<clang::FunctionDecl>(D)) {
-    auto name = FD->getNameAsString();
-    auto returnType = FD->getReturnType();
-    auto returnDeclIDAndTypeName = typeToDeclIDAndTypeName(returnType);
-    preEmitIfRecordDecl(returnType, returnDeclIDAndTypeName);
-    OrderedTypesMap parameters;
+    record.kind = TypeKind::Function;
+    record.returnType = reference(FD->getReturnType());
     for (const auto *param : FD->parameters()) {
-      auto paramType = param->getType();
-      auto paramDeclIDAndTypeName = typeToDeclIDAndTypeName(paramType);
-      preEmitIfRecordDecl(paramType, paramDeclIDAndTypeName);
-      parameters.emplace_back(param->getNameAsString(), paramDeclIDAndTypeName);
+      record.params.push_back(
+          {getDeclName(param, saver), reference(param->getType())});
     }
-    auto json =
-        json_function_decl(currentDeclIDAndTypeName, returnDeclIDAndTypeName,
-                           parameters, pseudoRoot, filePathComponents);
-    llvm::outs() << json << "\n";
     return true;
-  } else {
-    return true; // Ignore other types of declarations
   }
-  return true; // Fallthrough case, should not be reached.
+
+  return false; // Ignore other types of declarations
+}
+
+// Claim a declaration for emission, unless it should be skipped or has been
+//  claimed already.
+std::optional<TypeExtractorSession::ScheduledDecl>
+TypeExtractorSession::claimDecl(clang::NamedDecl *D, bool parseAnyway) {
+  // Redeclarations share a stable ID, so always emit the definition if there
+  //  is one (even when we're visiting a forward declaration).
+  if (auto TD = llvm::dyn_cast_or_null<clang::TagDecl>(D)) {
+    if (auto definition = TD->getDefinition()) {
+      D = definition;
+    }
+  }
+
+  // Skip if the declaration is not valid or should not be parsed.
+  if (!D || (!shouldParseDecl(D) && !parseAnyway)) {
+    return std::nullopt; // Ignore invalid or unparseable declarations
+  }
+
+  // Get the declaration ID.
+  llvm::SmallString<128> declID;
+  {
+    PhaseTimer timer(PhaseStats, ExtractionPhase::DeclIDs);
+    getDeclStableID(D, declID);
+  }
+  auto [it, inserted] = ProcessedDeclIDs.insert(declID);
+  ++Stats.dedupLookups;
+  if (!inserted) {
+    ++Stats.dedupHits;
+    return std::nullopt; // Skip if we've already processed this declaration ID.
+  }
+
+  // Handle the file path and ensure it's absolute.
+  llvm::StringRef absoluteFilePath;
+  {
+    PhaseTimer timer(PhaseStats, ExtractionPhase::Paths);
+    absoluteFilePath = getDeclFilePath(D);
+  }
+  if (!llvm::sys::path::is_absolute(absoluteFilePath)) {
+    return std::nullopt; // Somehow we got a relative path, skip it.
+  }
+  return ScheduledDecl{D, it->getKey(), absoluteFilePath};
+}
+
+bool TypeExtractorSession::emitTypeDecl(clang::NamedDecl *D,
+                                        bool parseAnyway) {
+  auto root = claimDecl(D, parseAnyway);
+  if (!root) {
+    return true;
+  }
+
+  // Collect the declarations to emit, each after the ones it references,
+  //  except where they reference each other in a cycle (through a pointer),
+  //  which is broken at a pointer. Dependencies that were claimed before
+  //  this call have been emitted already.
+  auto schedule = [&](const ScheduledDecl &scheduled) {
+    unsigned node = Scheduled.size();
+    Scheduled.push_back(scheduled);
+    ScheduledNodes[scheduled.decl->getCanonicalDecl()] = node;
+    return node;
+  };
+  auto getEdges = [&](unsigned node,
+                      llvm::SmallVectorImpl<DependencyEdge> &edges) {
+    llvm::SmallVector<Dependency, 8> dependencies;
+    getDependencies(Scheduled[node].decl, dependencies);
+    for (auto [decl, byValue] : dependencies) {
+      if (auto scheduled = claimDecl(decl, true)) {
+        edges.push_back({schedule(*scheduled), byValue});
+      } else if (auto it = ScheduledNodes.find(decl->getCanonicalDecl());
+                 it != ScheduledNodes.end()) {
+        edges.push_back({it->second, byValue});
+      }
+    }
+  };
+  Order.visit(schedule(*root), getEdges,
+              [&](unsigned node) { EmitOrder.push_back(Scheduled[node]); });
+  Order.clear();
+  Scheduled.clear();
+  ScheduledNodes.clear();
+
+  // Then emit them all in one pass.
+  for (const auto &scheduled : EmitOrder) {
+    emitScheduledDecl(scheduled);
+  }
+  EmitOrder.clear();
+  return true;
+}
+
+void TypeExtractorSession::emitScheduledDecl(const ScheduledDecl &scheduled) {
+  auto D = scheduled.decl;
+  auto declID = scheduled.declID;
+  auto absoluteFilePath = scheduled.filePath;
+  llvm::TimeTraceScope timeScope("TypeExtractor Decl",
+                                 [&] { return declID.str(); });
+
+  auto getHash = [&](llvm::StringRef referencedID) -> std::optional<uint64_t> {
+    auto it = RecordHashes.find(referencedID);
+    if (it == RecordHashes.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  };
+
+  // Replay the cached record if nothing it could depend on has changed,
+  //  including the hashes of the records it references.
+  CachePosition cachePosition = {0, 0};
+  if (Cache) {
+    auto &SM = D->getASTContext().getSourceManager();
+    cachePosition = Cache->locate(SM, SM.getExpansionLoc(D->getLocation()));
+    if (auto cached = Cache->lookup(declID, cachePosition, getHash)) {
+      RecordHashes[declID] = cached->hash;
+      if (isClaimedElsewhere(declID, cached->isDefinition)) {
+        return;
+      }
+      PhaseTimer timer(PhaseStats, ExtractionPhase::Serialization);
+      EmittedRecord emitted = {declID, cached->isDefinition, cached->json};
+      if (Serializer) {
+        // Queued like the others, to stay in order.
+        Serializer->addSerialized(emitted, cached->hash, absoluteFilePath,
+                                  cachePosition, cached->references);
+      } else {
+        Cache->store(absoluteFilePath, declID, cachePosition,
+                     cached->isDefinition, cached->hash, cached->references,
+                     cached->json);
+        Sink.asSerializedRecordSink()->handleSerializedRecord(emitted);
+      }
+      ReplayedDecls.insert(D);
+      ++Stats.replayedRecords;
+      return;
+    }
+  }
+
+  // == Common setup for all declarations ==
+
+  RecordAllocator.Reset();
+  llvm::StringSaver saver(RecordAllocator);
+  auto &record = CurrentRecord;
+  record.clear();
+  record.type = {declID, getDeclName(D, saver)};
+
+  {
+    PhaseTimer timer(PhaseStats, ExtractionPhase::Paths);
+    auto [fileRoot, filePath] =
+        getRelativeFilePathIfRelevant(absoluteFilePath, Sysroot, ResourceDir);
+    record.pseudoRoot = fileRootToPseudoRoot(fileRoot);
+    auto components = getPathComponents(filePath);
+    record.location.append(components.begin(), components.end());
+  }
+
+  // == Kind-specific declaration handling ==
+
+  if (buildTypeRecord(D, record, saver, *Types, PhaseStats)) {
+    ++Stats.recordsByKind[size_t(record.kind)];
+    // Everything the record references has been emitted before it, except
+    //  in cycles.
+    RecordReferences.clear();
+    record.hash = hashTypeRecord(record, [&](llvm::StringRef referencedID) {
+      auto hash = getHash(referencedID);
+      if (Cache) {
+        RecordReferences.emplace_back(referencedID, hash);
+      }
+      return hash;
+    });
+    RecordHashes[declID] = record.hash;
+    if (isClaimedElsewhere(declID, record.isDefinition)) {
+      return;
+    }
+    PhaseTimer timer(PhaseStats, ExtractionPhase::Serialization);
+    emitRecord(record, absoluteFilePath, cachePosition);
+  }
 }
 
 class TypeExtractorVisitor
     : public clang::RecursiveASTVisitor<TypeExtractorVisitor> {
+private:
+  TypeExtractorSession &Session;
+  // The declaration that was emitted before being traversed, whose visit is
+  //  then skipped.
+  clang::NamedDecl *EmittedBeforeTraversal = nullptr;
+
+  bool visit(clang::NamedDecl *D) {
+    if (D == EmittedBeforeTraversal) {
+      EmittedBeforeTraversal = nullptr;
+      return true;
+    }
+    return Session.emitTypeDecl(D);
+  }
+
 public:
-  bool VisitTypedefDecl(clang::TypedefDecl *TD) { return emitTypeDecl(TD); }
+  explicit TypeExtractorVisitor(TypeExtractorSession &session)
+      : Session(session) {}
+
+  // Prune whole subtrees that the filters exclude. With the incremental
+  //  cache, declarations are emitted right before they're traversed (which
+  //  is when they would be visited anyway, unless they're implicit), and the
+  //  subtrees of those that were replayed are pruned too: nothing inside
+  //  them is emitted on its own, besides the types they reference (which
+  //  were emitted before them) and friends.
+  bool TraverseDecl(clang::Decl *D) {
+    if (!Session.shouldTraverseDecl(D)) {
+      return true;
+    }
+    if (Session.Cache && D && !D->isImplicit() &&
+        llvm::isa<clang::TypedefNameDecl, clang::RecordDecl, clang::EnumDecl,
+                  clang::FunctionDecl>(D)) {
+      auto ND = llvm::cast<clang::NamedDecl>(D);
+      Session.emitTypeDecl(ND);
+      auto RD = llvm::dyn_cast<clang::CXXRecordDecl>(D);
+      if (Session.ReplayedDecls.contains(D) &&
+          !(RD && RD->hasDefinition() && RD->hasFriends())) {
+        return true;
+      }
+      EmittedBeforeTraversal = ND;
+    }
+    return RecursiveASTVisitor::TraverseDecl(D);
+  }
+
+  bool VisitTypedefNameDecl(clang::TypedefNameDecl *TD) { return visit(TD); }
 
-  bool VisitRecordDecl(clang::RecordDecl *RD) { return emitTypeDecl(RD); }
+  bool VisitRecordDecl(clang::RecordDecl *RD) { return visit(RD); }
 
-  bool VisitEnumDecl(clang::EnumDecl *ED) { return emitTypeDecl(ED); }
+  bool VisitEnumDecl(clang::EnumDecl *ED) { return visit(ED); }
 
-  bool VisitFunctionDecl(clang::FunctionDecl *FD) { return emitTypeDecl(FD); }
+  bool VisitFunctionDecl(clang::FunctionDecl *FD) { return visit(FD); }
 };
 
-class TypeExtractor : public clang::ASTConsumer {
-private:
-  TypeExtractorVisitor Visitor;
+// Emit the roots and the types they reference, instead of the whole TU.
+void TypeExtractorSession::emitRoots(clang::ASTContext &Context) {
+  auto TU = Context.getTranslationUnitDecl();
+  for (const auto &name : Options.rootNames) {
+    bool found = false;
+    for (auto D : TU->lookup(&Context.Idents.get(name))) {
+      if (llvm::isa<clang::TypedefNameDecl, clang::TagDecl,
+                    clang::FunctionDecl>(D)) {
+        emitTypeDecl(D, true);
+        found = true;
+      }
+    }
+    if (!found) {
+      llvm::errs() << "te: root '" << name << "' not found\n";
+    }
+  }
+}
 
-public:
-  void HandleTranslationUnit(clang::ASTContext &Context) override {
-    Visitor.TraverseDecl(Context.getTranslationUnitDecl());
+// Hash everything besides file contents that affects the output.
+static uint64_t hashInvocation(clang::CompilerInstance &CI) {
+  std::string invocation = clang::getClangFullVersion();
+  for (const auto &arg : CI.getInvocation().getCC1CommandLine()) {
+    invocation += '\0';
+    invocation += arg;
   }
-};
+  return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(invocation));
+}
+
+TypeExtractorSession::TypeExtractorSession(clang::CompilerInstance &CI,
+                                           RecordSink &sink,
+                                           ExtractorOptions options)
+    : Sink(sink), Options(std::move(options)),
+      Sysroot(CI.getHeaderSearchOpts().Sysroot),
+      ResourceDir(CI.getHeaderSearchOpts().ResourceDir),
+      PhaseStats(Options.collectStats ? &Stats : nullptr),
+      CreationTime(std::chrono::steady_clock::now()),
+      Types(std::make_unique<TypeCache>(Stats, PhaseStats)) {
+  auto compileGlobs = [](const std::vector<std::string> &globs,
+                         std::vector<llvm::GlobPattern> &patterns) {
+    for (const auto &glob : globs) {
+      auto pattern = llvm::GlobPattern::create(glob);
+      if (!pattern) {
+        llvm::errs() << "te: invalid path filter '" << glob
+                     << "': " << llvm::toString(pattern.takeError()) << "\n";
+        continue;
+      }
+      patterns.push_back(std::move(*pattern));
+    }
+  };
+  compileGlobs(Options.filters.includePaths, IncludePaths);
+  compileGlobs(Options.filters.excludePaths, ExcludePaths);
+  if (Options.incrementalCachePath) {
+    if (Sink.asSerializedRecordSink()) {
+      Cache = std::make_unique<IncrementalCache>(*Options.incrementalCachePath,
+                                                 hashInvocation(CI));
+    } else {
+      llvm::errs() << "te: the incremental cache needs serialized records, "
+                      "ignoring it\n";
+    }
+  }
+  if (Options.dedupStorePath) {
+    Dedup = DedupStore::open(*Options.dedupStorePath);
+  }
+  if (Options.serializationThreads != 1) {
+    if (auto serializedSink = Sink.asSerializedRecordSink()) {
+      Serializer = std::make_unique<ParallelSerializer>(
+          *serializedSink, Cache.get(), Options.serializationThreads);
+    } else {
+      llvm::errs() << "te: parallel serialization needs serialized records, "
+                      "ignoring it\n";
+    }
+  }
+}
+
+TypeExtractorSession::~TypeExtractorSession() = default;
+
+void TypeExtractorSession::HandleTranslationUnit(clang::ASTContext &Context) {
+  Stats = {};
+  Stats.phaseSeconds[size_t(ExtractionPhase::Parse)] =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                    CreationTime)
+          .count();
+  {
+    llvm::TimeTraceScope timeScope("TypeExtractor");
+    PhaseTimer timer(PhaseStats, ExtractionPhase::Extraction);
+    PathComponents.clear();
+    ProcessedDeclIDs.clear();
+    RecordHashes.clear();
+    ReplayedDecls.clear();
+    FilteredFiles.clear();
+    RecordAllocator.Reset();
+    Types->clear();
+    if (Cache) {
+      Cache->indexTranslationUnit(Context.getSourceManager());
+    }
+    if (Options.rootNames.empty()) {
+      TypeExtractorVisitor(*this).TraverseDecl(
+          Context.getTranslationUnitDecl());
+    } else {
+      emitRoots(Context);
+    }
+    PhaseTimer finishTimer(PhaseStats, ExtractionPhase::Serialization);
+    if (Serializer) {
+      Serializer->finish();
+    }
+    Sink.finish();
+    // Everything is written (in order) by the time we return.
+    if (OutputStream) {
+      OutputStream->drain();
+    }
+  }
+  Stats.bytesEmitted = Sink.getBytesWritten();
+  if (OutputStream) {
+    Stats.outputBlockedSeconds = OutputStream->getBlockedSeconds();
+  }
+
+  if (Options.collectStats) {
+    Stats.print(llvm::errs());
+  }
+  if (Cache && !Cache->save()) {
+    llvm::errs() << "te: failed to write the incremental cache\n";
+  }
+}
+
+bool TypeExtractorAction::BeginInvocation(clang::CompilerInstance &CI) {
+  if (Options.frontendProfile == FrontendProfile::Extract) {
+    applyExtractProfile(CI);
+  }
+  return clang::ASTFrontendAction::BeginInvocation(CI);
+}
+
+// Name the output of a translation unit after its main file, along with a
+//  hash of the file's path and of the compiler's output, which tells apart
+//  files with the same name and builds of the same file.
+static std::string getOutputName(clang::CompilerInstance &CI,
+                                 llvm::StringRef file) {
+  llvm::SmallString<256> identity(file);
+  llvm::sys::fs::make_absolute(identity);
+  identity.push_back('\0');
+  identity += CI.getFrontendOpts().OutputFile;
+  return (llvm::sys::path::filename(file) + "-" +
+          llvm::utohexstr(llvm::xxh3_64bits(
+                              llvm::arrayRefFromStringRef(identity.str())),
+                          /*LowerCase=*/true, /*Width=*/16))
+      .str();
+}
 
 std::unique_ptr<clang::ASTConsumer>
 TypeExtractorAction::CreateASTConsumer(clang::CompilerInstance &CI,
                                        llvm::StringRef file) {
-  sysroot = CI.getHeaderSearchOpts().Sysroot;
-  resourceDir = CI.getHeaderSearchOpts().ResourceDir;
-  return std::make_unique<TypeExtractor>();
-}
\ No newline at end of file
+  RecordSink *sink = Sink;
+  AsyncOutputStream *stream = nullptr;
+  auto outputName = getOutputName(CI, file);
+  if (!sink) {
+    llvm::raw_ostream *OS = &llvm::outs();
+    if (!Handler && (Options.asyncOutput ||
+                     Options.outputCompression != OutputCompression::None)) {
+      OwnedStream = std::make_unique<AsyncOutputStream>(
+          llvm::outs(), Options.outputCompression);
+      OS = stream = OwnedStream.get();
+    }
+    if (Handler) {
+      OwnedSink = std::make_unique<RecordHandlerSink>(Handler);
+    } else if (Options.shardDirectory) {
+      OwnedSink = std::make_unique<ShardedWriter>(*Options.shardDirectory);
+    } else if (Options.outputDirectory) {
+      OwnedSink = std::make_unique<OutputDirectoryWriter>(
+          *Options.outputDirectory, outputName);
+    } else if (Options.outputFormat == OutputFormat::Binary) {
+      OwnedSink = std::make_unique<BinaryWriter>(*OS);
+    } else if (Options.outputFormat == OutputFormat::NormalizedJSON) {
+      OwnedSink = std::make_unique<NormalizedWriter>(*OS);
+    } else {
+      OwnedSink = std::make_unique<JSONStreamSink>(*OS);
+    }
+    sink = OwnedSink.get();
+  }
+  auto session = std::make_unique<TypeExtractorSession>(CI, *sink, Options);
+  session->setOutputStream(stream);
+  session->setOutputName(outputName);
+  return session;
+}
+
+bool extractTypesFromCode(RecordSink &sink, llvm::StringRef code,
+                          const std::vector<std::string> &args,
+                          ExtractorOptions options, llvm::StringRef fileName) {
+  return clang::tooling::runToolOnCodeWithArgs(
+      std::make_unique<TypeExtractorAction>(sink, std::move(options)), code,
+      args, fileName);
+}
@@ -0,0 +1,140 @@
+#include "TypeRecord.h"
+#include "json.h"
+#include <llvm/Support/xxhash.h>
+
+namespace {
+
+// Builds up the input of a record's hash. Strings are prefixed by their
+//  length, so different records can't run together into the same input.
+class RecordHasher {
+private:
+  llvm::SmallVector<uint8_t, 512> Data;
+  llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)>
+      GetReferencedHash;
+
+public:
+  explicit RecordHasher(
+      llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)>
+          getReferencedHash)
+      : GetReferencedHash(getReferencedHash) {}
+
+  void add(uint64_t value) {
+    auto bytes = reinterpret_cast<const uint8_t *>(&value);
+    Data.append(bytes, bytes + sizeof(value));
+  }
+
+  void add(llvm::StringRef string) {
+    add(uint64_t(string.size()));
+    Data.append(string.bytes_begin(), string.bytes_end());
+  }
+
+  void add(const DeclIDAndTypeName &type) {
+    add(type.typeName);
+    if (!type.declID) {
+      add(uint64_t(0));
+    } else if (auto hash = GetReferencedHash(*type.declID)) {
+      add(uint64_t(1));
+      add(*hash);
+    } else {
+      add(uint64_t(2));
+      add(*type.declID);
+    }
+  }
+
+  uint64_t finish() const { return llvm::xxh3_64bits(Data); }
+};
+
+} // namespace
+
+uint64_t hashTypeRecord(
+    const TypeRecord &record,
+    llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)>
+        getReferencedHash) {
+  RecordHasher hasher(getReferencedHash);
+  hasher.add(uint64_t(record.kind));
+  hasher.add(uint64_t(record.isDefinition));
+  hasher.add(record.type.typeName);
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    hasher.add(record.underlyingType);
+    break;
+  case TypeKind::Struct:
+    hasher.add(uint64_t(record.fields.size()));
+    for (const auto &field : record.fields) {
+      hasher.add(field.name);
+      hasher.add(uint64_t(field.offset));
+      hasher.add(uint64_t(field.size));
+      hasher.add(field.type);
+    }
+    break;
+  case TypeKind::Union:
+    hasher.add(uint64_t(record.members.size()));
+    for (const auto &member : record.members) {
+      hasher.add(member.name);
+      hasher.add(member.type);
+    }
+    break;
+  case TypeKind::Enum:
+    hasher.add(record.backingType);
+    hasher.add(uint64_t(record.entries.size()));
+    for (const auto &entry : record.entries) {
+      hasher.add(entry.name);
+      hasher.add(entry.value);
+    }
+    break;
+  case TypeKind::Function:
+    hasher.add(record.returnType);
+    hasher.add(uint64_t(record.params.size()));
+    for (const auto &param : record.params) {
+      hasher.add(param.name);
+      hasher.add(param.type);
+    }
+    break;
+  }
+  return hasher.finish();
+}
+
+void writeTypeRecordJSON(llvm::raw_ostream &OS, const TypeRecord &record) {
+  json_type_record(OS, record);
+}
+
+static DeclIDAndTypeName copyType(const DeclIDAndTypeName &type,
+                                  llvm::StringSaver &saver) {
+  DeclIDAndTypeName copy;
+  if (type.declID) {
+    copy.declID = saver.save(*type.declID);
+  }
+  copy.typeName = saver.save(type.typeName);
+  return copy;
+}
+
+TypeRecord copyTypeRecord(const TypeRecord &record, llvm::StringSaver &saver) {
+  TypeRecord copy;
+  copy.kind = record.kind;
+  copy.type = copyType(record.type, saver);
+  copy.isDefinition = record.isDefinition;
+  copy.hash = record.hash;
+  copy.pseudoRoot = saver.save(record.pseudoRoot);
+  for (const auto &component : record.location) {
+    copy.location.push_back(saver.save(component));
+  }
+  copy.underlyingType = copyType(record.underlyingType, saver);
+  for (const auto &field : record.fields) {
+    copy.fields.push_back({saver.save(field.name), field.offset, field.size,
+                           copyType(field.type, saver)});
+  }
+  for (const auto &member : record.members) {
+    copy.members.push_back(
+        {saver.save(member.name), copyType(member.type, saver)});
+  }
+  copy.backingType = copyType(record.backingType, saver);
+  for (const auto &entry : record.entries) {
+    copy.entries.push_back({saver.save(entry.name), entry.value});
+  }
+  copy.returnType = copyType(record.returnType, saver);
+  for (const auto &param : record.params) {
+    copy.params.push_back(
+        {saver.save(param.name), copyType(param.type, saver)});
+  }
+  return copy;
+}
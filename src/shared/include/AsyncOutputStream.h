@@ -0,0 +1,65 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <thread>
+
+#ifndef TYPE_EXTRACTOR_ASYNC_OUTPUT_STREAM_H
+#define TYPE_EXTRACTOR_ASYNC_OUTPUT_STREAM_H
+
+enum class OutputCompression { None, Gzip, Zstd };
+
+// A stream that hands its output to a writer thread, which (optionally
+//  compresses it and) writes it to another stream, so that writing never
+//  stalls whoever is producing the output unless the writer falls behind.
+//
+// Output is passed on in chunks of the buffer size, through a bounded queue
+//  that only uses atomics. Chunks are written in order, so the output is the
+//  same as if it had been written directly. When compressed, each chunk is a
+//  separate gzip member or zstd frame, which decoders read one after another.
+class AsyncOutputStream : public llvm::raw_ostream {
+private:
+  static constexpr size_t chunkSize = 256 * 1024;
+  static constexpr size_t queueCapacity = 16;
+
+  llvm::raw_ostream &Underlying;
+  OutputCompression Compression;
+  uint64_t Position = 0;
+  double BlockedSeconds = 0;
+
+  // Chunks from `Head` (popped by the writer) up to `Tail` (pushed by the
+  //  producer) are queued. An empty chunk ends the output.
+  std::array<std::string, queueCapacity> Slots;
+  std::atomic<uint64_t> Head = 0;
+  std::atomic<uint64_t> Tail = 0;
+  std::thread Writer;
+  llvm::SmallVector<uint8_t, 0> Compressed;
+
+  void write_impl(const char *ptr, size_t size) override;
+  uint64_t current_pos() const override { return Position; }
+
+  void push(llvm::StringRef chunk);
+  void runWriter();
+  void writeChunk(llvm::StringRef chunk);
+  void writeGzipMember(llvm::StringRef chunk);
+
+public:
+  // The compression must be available (see `getCompressionError`).
+  AsyncOutputStream(llvm::raw_ostream &underlying,
+                    OutputCompression compression = OutputCompression::None);
+  // Write out everything left, and stop the writer.
+  ~AsyncOutputStream() override;
+
+  // Wait until everything written so far has reached the underlying stream.
+  void drain();
+
+  // Total time spent waiting for the writer, in `write` and `drain`.
+  double getBlockedSeconds() const { return BlockedSeconds; }
+
+  // Why the compression can't be used, or null if it can.
+  static const char *getCompressionError(OutputCompression compression);
+};
+
+#endif // TYPE_EXTRACTOR_ASYNC_OUTPUT_STREAM_H
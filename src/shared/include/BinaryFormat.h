@@ -0,0 +1,355 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#ifndef TYPE_EXTRACTOR_BINARY_FORMAT_H
+#define TYPE_EXTRACTOR_BINARY_FORMAT_H
+
+// The binary output format, and a header-only reader for it that doesn't need
+//  LLVM. It carries exactly what the JSON records do.
+//
+// A file is laid out as:
+//
+//   BinaryFileHeader
+//   the records, each one being:
+//     BinaryRecordHeader
+//     its location, as `locationCount` string offsets (padded to 8 bytes)
+//     its `itemCount` items (fields, members, entries or params), whose type
+//      depends on the kind of the record
+//   the string table, of NUL-terminated strings
+//   the record index, as the file offset of each record (uint64_t)
+//   BinaryFileFooter
+//
+// Strings are referred to by their offset into the string table, and every
+//  structure is 8-byte aligned so the file can be used in place once mapped.
+//  Values are in the byte order of the machine that wrote the file.
+
+inline constexpr char binaryMagic[8] = {'T', 'E', 'B', 'I', 'N', 'A', 'R', 'Y'};
+inline constexpr uint32_t binaryVersion = 2;
+// String offset used for a missing string (e.g. a null "declID").
+inline constexpr uint32_t binaryNoString = UINT32_MAX;
+
+// Same values as `TypeKind`.
+enum class BinaryTypeKind : uint8_t { Typedef, Struct, Union, Enum, Function };
+
+struct BinaryFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct BinaryTypeRef {
+  uint32_t declID;
+  uint32_t typeName;
+};
+
+struct BinaryRecordHeader {
+  uint8_t kind;
+  uint8_t isDefinition;
+  uint16_t reserved;
+  uint32_t locationCount;
+  uint32_t itemCount;
+  uint32_t pseudoRoot;
+  BinaryTypeRef type;
+  // The underlying type of a typedef, the backing type of an enum or the
+  //  return type of a function.
+  BinaryTypeRef auxiliaryType;
+  // The structural hash of the record.
+  uint64_t hash;
+};
+
+// Item of a struct.
+struct BinaryStructField {
+  uint32_t name;
+  uint32_t reserved;
+  int64_t offset;
+  int64_t size;
+  BinaryTypeRef type;
+};
+
+// Item of a union (a member) or of a function (a parameter).
+struct BinaryNamedType {
+  uint32_t name;
+  BinaryTypeRef type;
+  uint32_t reserved;
+};
+
+// Item of an enum.
+struct BinaryEnumEntry {
+  uint32_t name;
+  uint32_t reserved;
+  uint64_t value;
+};
+
+struct BinaryFileFooter {
+  uint64_t stringTableOffset;
+  uint64_t stringTableSize;
+  uint64_t recordIndexOffset;
+  uint64_t recordCount;
+  uint32_t version;
+  uint32_t reserved;
+  char magic[8];
+};
+
+static_assert(sizeof(BinaryFileHeader) == 16);
+static_assert(sizeof(BinaryRecordHeader) == 40);
+static_assert(sizeof(BinaryStructField) == 32);
+static_assert(sizeof(BinaryNamedType) == 16);
+static_assert(sizeof(BinaryEnumEntry) == 16);
+static_assert(sizeof(BinaryFileFooter) == 48);
+
+// Size of the items of a record of the given kind.
+inline size_t binaryItemSize(BinaryTypeKind kind) {
+  switch (kind) {
+  case BinaryTypeKind::Struct:
+    return sizeof(BinaryStructField);
+  case BinaryTypeKind::Union:
+  case BinaryTypeKind::Function:
+    return sizeof(BinaryNamedType);
+  case BinaryTypeKind::Enum:
+    return sizeof(BinaryEnumEntry);
+  case BinaryTypeKind::Typedef:
+    return 0;
+  }
+  return 0;
+}
+
+// Size of the location of a record, including padding.
+inline size_t binaryLocationSize(uint32_t locationCount) {
+  return (size_t(locationCount) * sizeof(uint32_t) + 7) & ~size_t(7);
+}
+
+class BinaryTypeFile;
+
+// A view of one record, pointing into the file.
+class BinaryRecordView {
+private:
+  const BinaryTypeFile *File;
+  const BinaryRecordHeader *Header;
+
+  const std::byte *items() const {
+    return reinterpret_cast<const std::byte *>(Header + 1) +
+           binaryLocationSize(Header->locationCount);
+  }
+
+public:
+  BinaryRecordView(const BinaryTypeFile *file, const BinaryRecordHeader *header)
+      : File(file), Header(header) {}
+
+  BinaryTypeKind kind() const { return BinaryTypeKind(Header->kind); }
+  bool isDefinition() const { return Header->isDefinition; }
+  const BinaryTypeRef &type() const { return Header->type; }
+  const BinaryTypeRef &auxiliaryType() const { return Header->auxiliaryType; }
+  uint32_t pseudoRoot() const { return Header->pseudoRoot; }
+  uint64_t hash() const { return Header->hash; }
+
+  std::span<const uint32_t> location() const {
+    return {reinterpret_cast<const uint32_t *>(Header + 1),
+            Header->locationCount};
+  }
+
+  // Empty unless this is a struct.
+  std::span<const BinaryStructField> fields() const {
+    if (kind() != BinaryTypeKind::Struct) {
+      return {};
+    }
+    return {reinterpret_cast<const BinaryStructField *>(items()),
+            Header->itemCount};
+  }
+
+  // Members of a union or parameters of a function, empty otherwise.
+  std::span<const BinaryNamedType> namedTypes() const {
+    if (kind() != BinaryTypeKind::Union && kind() != BinaryTypeKind::Function) {
+      return {};
+    }
+    return {reinterpret_cast<const BinaryNamedType *>(items()),
+            Header->itemCount};
+  }
+
+  // Empty unless this is an enum.
+  std::span<const BinaryEnumEntry> entries() const {
+    if (kind() != BinaryTypeKind::Enum) {
+      return {};
+    }
+    return {reinterpret_cast<const BinaryEnumEntry *>(items()),
+            Header->itemCount};
+  }
+};
+
+// A validated binary file, either borrowed from memory or mapped from disk.
+//  Accessing it never parses or allocates.
+class BinaryTypeFile {
+private:
+  const std::byte *Data = nullptr;
+  size_t Size = 0;
+  const BinaryFileFooter *Footer = nullptr;
+  const uint64_t *RecordIndex = nullptr;
+  void *Mapping = nullptr;
+
+  BinaryTypeFile() = default;
+
+  bool validate() {
+    if (Size < sizeof(BinaryFileHeader) + sizeof(BinaryFileFooter) ||
+        reinterpret_cast<uintptr_t>(Data) % 8 != 0) {
+      return false;
+    }
+    auto header = reinterpret_cast<const BinaryFileHeader *>(Data);
+    Footer = reinterpret_cast<const BinaryFileFooter *>(
+        Data + Size - sizeof(BinaryFileFooter));
+    if (std::memcmp(header->magic, binaryMagic, sizeof(binaryMagic)) != 0 ||
+        std::memcmp(Footer->magic, binaryMagic, sizeof(binaryMagic)) != 0 ||
+        header->version != binaryVersion || Footer->version != binaryVersion) {
+      return false;
+    }
+    size_t footerOffset = Size - sizeof(BinaryFileFooter);
+    if (Footer->stringTableOffset > footerOffset ||
+        Footer->stringTableSize > footerOffset - Footer->stringTableOffset ||
+        Footer->recordIndexOffset % 8 != 0 ||
+        Footer->recordIndexOffset > footerOffset ||
+        Footer->recordCount >
+            (footerOffset - Footer->recordIndexOffset) / sizeof(uint64_t)) {
+      return false;
+    }
+    RecordIndex =
+        reinterpret_cast<const uint64_t *>(Data + Footer->recordIndexOffset);
+
+    // Check that every record lies within the record section.
+    for (uint64_t i = 0; i < Footer->recordCount; ++i) {
+      uint64_t offset = RecordIndex[i];
+      if (offset % 8 != 0 || offset < sizeof(BinaryFileHeader) ||
+          offset > Footer->stringTableOffset ||
+          Footer->stringTableOffset - offset < sizeof(BinaryRecordHeader)) {
+        return false;
+      }
+      auto record = reinterpret_cast<const BinaryRecordHeader *>(Data + offset);
+      if (record->kind > uint8_t(BinaryTypeKind::Function)) {
+        return false;
+      }
+      uint64_t recordSize =
+          sizeof(BinaryRecordHeader) +
+          binaryLocationSize(record->locationCount) +
+          uint64_t(record->itemCount) *
+              binaryItemSize(BinaryTypeKind(record->kind));
+      if (recordSize > Footer->stringTableOffset - offset) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  BinaryTypeFile(const BinaryTypeFile &) = delete;
+  BinaryTypeFile &operator=(const BinaryTypeFile &) = delete;
+  BinaryTypeFile(BinaryTypeFile &&other) noexcept { *this = std::move(other); }
+  BinaryTypeFile &operator=(BinaryTypeFile &&other) noexcept {
+    std::swap(Data, other.Data);
+    std::swap(Size, other.Size);
+    std::swap(Footer, other.Footer);
+    std::swap(RecordIndex, other.RecordIndex);
+    std::swap(Mapping, other.Mapping);
+    return *this;
+  }
+  ~BinaryTypeFile() {
+    if (Mapping) {
+      munmap(Mapping, Size);
+    }
+  }
+
+  // Use a file that's already in (8-byte aligned) memory, without copying it.
+  static std::optional<BinaryTypeFile> fromBuffer(const void *data,
+                                                  size_t size) {
+    BinaryTypeFile file;
+    file.Data = static_cast<const std::byte *>(data);
+    file.Size = size;
+    if (!file.validate()) {
+      return std::nullopt;
+    }
+    return file;
+  }
+
+  // Map a file from disk.
+  static std::optional<BinaryTypeFile> open(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return std::nullopt;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+      close(fd);
+      return std::nullopt;
+    }
+    void *mapping =
+        mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      return std::nullopt;
+    }
+    BinaryTypeFile file;
+    file.Data = static_cast<const std::byte *>(mapping);
+    file.Size = size_t(status.st_size);
+    file.Mapping = mapping;
+    if (!file.validate()) {
+      return std::nullopt; // Unmapped by the destructor.
+    }
+    return file;
+  }
+
+  size_t recordCount() const { return Footer->recordCount; }
+
+  BinaryRecordView record(size_t index) const {
+    return {this,
+            reinterpret_cast<const BinaryRecordHeader *>(Data + RecordIndex[index])};
+  }
+
+  // Get a string from the string table. Out-of-range offsets give an empty
+  //  string.
+  std::string_view string(uint32_t offset) const {
+    if (offset >= Footer->stringTableSize) {
+      return {};
+    }
+    auto start =
+        reinterpret_cast<const char *>(Data + Footer->stringTableOffset) +
+        offset;
+    size_t maxLength = Footer->stringTableSize - offset;
+    auto end = static_cast<const char *>(std::memchr(start, '\0', maxLength));
+    return {start, end ? size_t(end - start) : maxLength};
+  }
+
+  std::optional<std::string_view> optionalString(uint32_t offset) const {
+    if (offset == binaryNoString) {
+      return std::nullopt;
+    }
+    return string(offset);
+  }
+
+  class iterator {
+  private:
+    const BinaryTypeFile *File;
+    size_t Index;
+
+  public:
+    iterator(const BinaryTypeFile *file, size_t index)
+        : File(file), Index(index) {}
+    BinaryRecordView operator*() const { return File->record(Index); }
+    iterator &operator++() {
+      ++Index;
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return Index == other.Index;
+    }
+  };
+
+  iterator begin() const { return {this, 0}; }
+  iterator end() const { return {this, recordCount()}; }
+};
+
+#endif // TYPE_EXTRACTOR_BINARY_FORMAT_H
@@ -0,0 +1,12 @@
+#include "BinaryFormat.h"
+#include "TypeRecord.h"
+
+#ifndef TYPE_EXTRACTOR_BINARY_READER_H
+#define TYPE_EXTRACTOR_BINARY_READER_H
+
+// Convert a record of a binary file back into the `TypeRecord` it was
+//  written from. The strings point into the file.
+TypeRecord readBinaryRecord(const BinaryTypeFile &file,
+                            const BinaryRecordView &view);
+
+#endif // TYPE_EXTRACTOR_BINARY_READER_H
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_DEPENDENCY_ORDER_H
+#define TYPE_EXTRACTOR_DEPENDENCY_ORDER_H
+
+// An edge to a node that another one depends on. If `byValue`, the node
+//  contains it (e.g. as a field, or as the target of a typedef), so it must
+//  come first. Otherwise (e.g. behind a pointer), it comes first unless the
+//  two are in a cycle.
+struct DependencyEdge {
+  unsigned node;
+  bool byValue;
+};
+
+// Orders the nodes of a dependency graph so that each comes after the ones
+//  it depends on, depth-first with an explicit stack (so that long chains
+//  can't overflow the call stack). Nodes are numbered by the caller, as they
+//  are discovered through the edges.
+//
+// Nodes that depend on each other in a cycle form a strongly connected
+//  component (found with Tarjan's algorithm). A cycle always goes through a
+//  pointer, so within a component only the by-value edges are followed,
+//  starting from the nodes in the order the search finished them. Anything
+//  outside of a cycle comes out in depth-first postorder.
+class DependencyOrder {
+private:
+  struct Node {
+    bool visited = false;
+    bool onStack = false;
+    bool placed = false;
+    unsigned index = 0;
+    unsigned lowLink = 0;
+    unsigned finished = 0;
+    // The root of the component, once it's known.
+    unsigned component = ~0u;
+    llvm::SmallVector<DependencyEdge, 4> edges = {};
+  };
+  struct Frame {
+    unsigned node;
+    unsigned nextEdge;
+  };
+
+  std::vector<Node> Nodes;
+  std::vector<Frame> Stack;
+  // The stack for ordering the nodes of a component.
+  std::vector<Frame> ComponentStack;
+  // Visited nodes whose component isn't known yet, in the order they were
+  //  visited.
+  std::vector<unsigned> Unassigned;
+  std::vector<unsigned> Members;
+  unsigned NextIndex = 0;
+  unsigned NextFinished = 0;
+
+  Node &get(unsigned node) {
+    if (node >= Nodes.size()) {
+      Nodes.resize(node + 1);
+    }
+    return Nodes[node];
+  }
+
+  template <typename Emit> void emitComponent(unsigned root, Emit &emit) {
+    auto start = llvm::find(Unassigned, root);
+    Members.assign(start, Unassigned.end());
+    Unassigned.erase(start, Unassigned.end());
+    for (auto member : Members) {
+      Nodes[member].onStack = false;
+      Nodes[member].component = root;
+    }
+    if (Members.size() == 1) {
+      Nodes[root].placed = true;
+      emit(root);
+      return;
+    }
+
+    llvm::sort(Members, [&](unsigned a, unsigned b) {
+      return Nodes[a].finished < Nodes[b].finished;
+    });
+    for (auto member : Members) {
+      if (Nodes[member].placed) {
+        continue;
+      }
+      Nodes[member].placed = true;
+      ComponentStack.push_back({member, 0});
+      while (!ComponentStack.empty()) {
+        auto &frame = ComponentStack.back();
+        auto &node = Nodes[frame.node];
+        if (frame.nextEdge < node.edges.size()) {
+          auto edge = node.edges[frame.nextEdge++];
+          auto &target = Nodes[edge.node];
+          if (edge.byValue && target.component == root && !target.placed) {
+            target.placed = true;
+            ComponentStack.push_back({edge.node, 0});
+          }
+          continue;
+        }
+        emit(frame.node);
+        ComponentStack.pop_back();
+      }
+    }
+  }
+
+public:
+  // Emit `root` and every node it (transitively) depends on that hasn't
+  //  been visited yet. `getEdges(node, edges)` adds the edges of a node, and
+  //  is called once for each, while `emit(node)` is called in order.
+  template <typename GetEdges, typename Emit>
+  void visit(unsigned root, GetEdges &&getEdges, Emit &&emit) {
+    auto push = [&](unsigned id) {
+      auto &node = get(id);
+      node.visited = true;
+      node.onStack = true;
+      node.index = node.lowLink = NextIndex++;
+      Unassigned.push_back(id);
+      getEdges(id, node.edges);
+      for (size_t i = 0; i < Nodes[id].edges.size(); ++i) {
+        get(Nodes[id].edges[i].node);
+      }
+      Stack.push_back({id, 0});
+    };
+
+    if (get(root).visited) {
+      return;
+    }
+    push(root);
+    while (!Stack.empty()) {
+      auto [id, nextEdge] = Stack.back();
+      if (nextEdge < Nodes[id].edges.size()) {
+        ++Stack.back().nextEdge;
+        auto edge = Nodes[id].edges[nextEdge];
+        if (!Nodes[edge.node].visited) {
+          push(edge.node);
+        } else if (Nodes[edge.node].onStack) {
+          Nodes[id].lowLink =
+              std::min(Nodes[id].lowLink, Nodes[edge.node].index);
+        }
+        continue;
+      }
+      Stack.pop_back();
+      Nodes[id].finished = NextFinished++;
+      if (!Stack.empty()) {
+        auto &parent = Nodes[Stack.back().node];
+        parent.lowLink = std::min(parent.lowLink, Nodes[id].lowLink);
+      }
+      if (Nodes[id].lowLink == Nodes[id].index) {
+        emitComponent(id, emit);
+      }
+    }
+  }
+
+  // Forget every node, keeping the memory for reuse.
+  void clear() {
+    Nodes.clear();
+    NextIndex = 0;
+    NextFinished = 0;
+  }
+};
+
+#endif // TYPE_EXTRACTOR_DEPENDENCY_ORDER_H
@@ -0,0 +1,103 @@
+#include "TypeRecord.h"
+#include <chrono>
+#include <cstdint>
+#include <llvm/Support/raw_ostream.h>
+
+#ifndef TYPE_EXTRACTOR_EXTRACTION_STATS_H
+#define TYPE_EXTRACTOR_EXTRACTION_STATS_H
+
+// Parts of the extraction that are timed separately.
+enum class ExtractionPhase {
+  // From the creation of the session until the AST is handed to it.
+  Parse,
+  // All of the extraction, which includes the phases below.
+  Extraction,
+  // Record layouts and type sizes.
+  Layout,
+  // Printing type names (and getting the IDs of their declarations), the
+  //  first time each type is referenced.
+  TypeNames,
+  // Getting stable IDs of declarations.
+  DeclIDs,
+  // Resolving the files of declarations and splitting their paths.
+  Paths,
+  // Handing records to the sink.
+  Serialization,
+};
+inline constexpr size_t extractionPhaseCount = 7;
+
+inline llvm::StringRef extractionPhaseName(ExtractionPhase phase) {
+  switch (phase) {
+  case ExtractionPhase::Parse:
+    return "parse";
+  case ExtractionPhase::Extraction:
+    return "extraction";
+  case ExtractionPhase::Layout:
+    return "layout";
+  case ExtractionPhase::TypeNames:
+    return "type names";
+  case ExtractionPhase::DeclIDs:
+    return "declaration IDs";
+  case ExtractionPhase::Paths:
+    return "paths";
+  case ExtractionPhase::Serialization:
+    return "serialization";
+  }
+  return "unknown"; // Fallback, should not be reached.
+}
+
+// Counters of one extraction. The phase timings are only collected when
+//  `ExtractorOptions::collectStats` is set, while the counters always are.
+struct ExtractionStats {
+  double phaseSeconds[extractionPhaseCount] = {};
+  // Records built, by `TypeKind`.
+  uint64_t recordsByKind[5] = {};
+  // Records replayed from the incremental cache.
+  uint64_t replayedRecords = 0;
+  // Output written by the sink, if it keeps track.
+  uint64_t bytesEmitted = 0;
+  // Declarations skipped by the filters (not counting the ones inside them).
+  uint64_t skippedDecls = 0;
+  // Declaration ID claims, and how many were already claimed.
+  uint64_t dedupLookups = 0;
+  uint64_t dedupHits = 0;
+  // Records skipped as another process sharing the dedup store wrote them.
+  uint64_t sharedDedupHits = 0;
+  // Path component lookups, and how many were already split.
+  uint64_t pathLookups = 0;
+  uint64_t pathHits = 0;
+  // Type spelling and size lookups, and how many were already known.
+  uint64_t typeCacheLookups = 0;
+  uint64_t typeCacheHits = 0;
+  // Time spent waiting for asynchronous output to be written.
+  double outputBlockedSeconds = 0;
+
+  void print(llvm::raw_ostream &OS) const;
+};
+
+// Adds the time until it goes out of scope to a phase, if there are stats to
+//  add it to.
+class PhaseTimer {
+private:
+  ExtractionStats *Stats;
+  ExtractionPhase Phase;
+  std::chrono::steady_clock::time_point Start;
+
+public:
+  PhaseTimer(ExtractionStats *stats, ExtractionPhase phase)
+      : Stats(stats), Phase(phase) {
+    if (Stats) {
+      Start = std::chrono::steady_clock::now();
+    }
+  }
+  ~PhaseTimer() {
+    if (Stats) {
+      Stats->phaseSeconds[size_t(Phase)] +=
+          std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        Start)
+              .count();
+    }
+  }
+};
+
+#endif // TYPE_EXTRACTOR_EXTRACTION_STATS_H
@@ -0,0 +1,68 @@
+#include "RecordSink.h"
+#include "TypeRecord.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_LAYOUT_SWEEP_H
+#define TYPE_EXTRACTOR_LAYOUT_SWEEP_H
+
+// Merges the records of one set of headers extracted for several targets, so
+//  that each type is written once. Records that only differ in the offsets
+//  and sizes of their fields are written once, with a "targetLayouts" object
+//  holding the layout of every target that differs from the first one. A
+//  record that differs in anything else (or is missing for some targets) is
+//  written once per variant, with a "targets" array of the targets it's for.
+//
+// Each target's records are collected by its own sink, so the targets can be
+//  extracted concurrently.
+class LayoutSweepMerger {
+private:
+  // The records of one target, copied out of its AST.
+  class TargetSink : public RecordSink {
+  public:
+    std::string Triple;
+    llvm::BumpPtrAllocator Allocator;
+    llvm::StringSaver Saver{Allocator};
+    std::vector<TypeRecord> Records;
+
+    explicit TargetSink(std::string triple) : Triple(std::move(triple)) {}
+
+    void handleRecord(const TypeRecord &record) override;
+  };
+
+  // The targets that share one version of a record.
+  struct Variant {
+    // The record of the first of the targets.
+    const TypeRecord *record;
+    std::vector<size_t> targets;
+    // The targets whose field layouts differ from `record`'s.
+    std::vector<std::pair<size_t, const TypeRecord *>> layouts = {};
+    // The targets whose structural hashes differ from `record`'s, which
+    //  they do whenever their layouts differ, or those of a type they
+    //  reference.
+    std::vector<std::pair<size_t, const TypeRecord *>> hashes = {};
+  };
+
+  std::vector<std::unique_ptr<TargetSink>> Targets;
+
+  void writeVariant(llvm::raw_ostream &OS, const Variant &variant);
+
+public:
+  explicit LayoutSweepMerger(const std::vector<std::string> &triples);
+
+  // The sink for the target at `index`. Each one may be used on its own
+  //  thread.
+  RecordSink &getSink(size_t index) { return *Targets[index]; }
+
+  // Write the merged records as JSON lines, once every target is extracted.
+  //  A record always comes after the records it references, as long as that
+  //  holds for each target.
+  void write(llvm::raw_ostream &OS);
+};
+
+#endif // TYPE_EXTRACTOR_LAYOUT_SWEEP_H
@@ -0,0 +1,37 @@
+#include "RecordSink.h"
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <string>
+
+#ifndef TYPE_EXTRACTOR_OUTPUT_DIRECTORY_WRITER_H
+#define TYPE_EXTRACTOR_OUTPUT_DIRECTORY_WRITER_H
+
+// Writes the records of one translation unit as JSON lines into a directory
+//  that the translation units of a whole build share, for `te merge` to
+//  combine. Definitions go to `<name>.jsonl`, and records that are only
+//  forward-declared to `<name>.forward.jsonl`, as the JSON doesn't tell them
+//  apart. Both files are written under temporary names and only renamed
+//  into place once the translation unit is done, so an interrupted compile
+//  never leaves partial output behind.
+class OutputDirectoryWriter : public SerializedRecordSink {
+private:
+  std::string Path;
+  std::unique_ptr<llvm::raw_fd_ostream> Definitions;
+  std::unique_ptr<llvm::raw_fd_ostream> ForwardDeclarations;
+  uint64_t BytesWritten = 0;
+
+public:
+  // `name` should be unique to the translation unit within the build.
+  OutputDirectoryWriter(llvm::StringRef directory, llvm::StringRef name);
+
+  void handleSerializedRecord(const EmittedRecord &record) override;
+
+  void finish() override;
+
+  uint64_t getBytesWritten() const override { return BytesWritten; }
+};
+
+inline constexpr llvm::StringLiteral forwardDeclarationsExtension =
+    ".forward.jsonl";
+
+#endif // TYPE_EXTRACTOR_OUTPUT_DIRECTORY_WRITER_H
@@ -0,0 +1,29 @@
+#include <llvm/Support/JSON.h>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_RECORD_JSON_H
+#define TYPE_EXTRACTOR_RECORD_JSON_H
+
+// Collect the IDs of the types `value` (part of a record of the default
+//  format, usually its "properties") references.
+inline void collectReferences(const llvm::json::Value &value,
+                              std::vector<std::string> &declIDs) {
+  if (auto object = value.getAsObject()) {
+    for (const auto &[key, member] : *object) {
+      if (key == "declID") {
+        if (auto declID = member.getAsString()) {
+          declIDs.push_back(declID->str());
+        }
+      } else {
+        collectReferences(member, declIDs);
+      }
+    }
+  } else if (auto array = value.getAsArray()) {
+    for (const auto &element : *array) {
+      collectReferences(element, declIDs);
+    }
+  }
+}
+
+#endif // TYPE_EXTRACTOR_RECORD_JSON_H
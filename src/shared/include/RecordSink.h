@@ -0,0 +1,100 @@
+#include "TypeRecord.h"
+#include <cstdint>
+#include <functional>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+
+#ifndef TYPE_EXTRACTOR_RECORD_SINK_H
+#define TYPE_EXTRACTOR_RECORD_SINK_H
+
+class SerializedRecordSink;
+
+// Receives the records of an extraction, in the order they're emitted (with
+//  the types a record references coming before it).
+class RecordSink {
+public:
+  virtual ~RecordSink() = default;
+
+  // The record (and the strings it points to) are only valid for the
+  //  duration of the call.
+  virtual void handleRecord(const TypeRecord &record) = 0;
+
+  // Called once the translation unit has been extracted.
+  virtual void finish() {}
+
+  // Bytes of output written so far, for sinks that write any.
+  virtual uint64_t getBytesWritten() const { return 0; }
+
+  // Sinks that consume serialized JSON return themselves here, which lets
+  //  the extractor replay records from the incremental cache without
+  //  building them again.
+  virtual SerializedRecordSink *asSerializedRecordSink() { return nullptr; }
+};
+
+// A single serialized declaration, as handed to a `SerializedRecordSink`.
+struct EmittedRecord {
+  // Stable (cross-TU) ID of the declaration.
+  llvm::StringRef declID;
+  // False for records that are only forward-declared in this TU.
+  bool isDefinition;
+  // The JSON line, without a trailing newline.
+  llvm::StringRef json;
+};
+
+// A sink that consumes records as the JSON lines of the default format.
+class SerializedRecordSink : public RecordSink {
+private:
+  std::string Scratch;
+
+public:
+  void handleRecord(const TypeRecord &record) override;
+
+  virtual void handleSerializedRecord(const EmittedRecord &record) = 0;
+
+  SerializedRecordSink *asSerializedRecordSink() override { return this; }
+};
+
+typedef std::function<void(const EmittedRecord &)> RecordHandler;
+
+// Hands serialized records to a callback.
+class RecordHandlerSink : public SerializedRecordSink {
+private:
+  RecordHandler Handler;
+  uint64_t BytesWritten = 0;
+
+public:
+  explicit RecordHandlerSink(RecordHandler handler)
+      : Handler(std::move(handler)) {}
+
+  void handleSerializedRecord(const EmittedRecord &record) override {
+    BytesWritten += record.json.size() + 1;
+    Handler(record);
+  }
+
+  uint64_t getBytesWritten() const override { return BytesWritten; }
+};
+
+// Writes records to a stream as JSON lines.
+class JSONStreamSink : public SerializedRecordSink {
+private:
+  llvm::raw_ostream &OS;
+  uint64_t StartPosition;
+
+public:
+  explicit JSONStreamSink(llvm::raw_ostream &OS)
+      : OS(OS), StartPosition(OS.tell()) {}
+
+  // Written straight to the stream, without serializing to a string first.
+  void handleRecord(const TypeRecord &record) override;
+
+  void handleSerializedRecord(const EmittedRecord &record) override;
+
+  void finish() override { OS.flush(); }
+
+  uint64_t getBytesWritten() const override {
+    return OS.tell() - StartPosition;
+  }
+};
+
+#endif // TYPE_EXTRACTOR_RECORD_SINK_H
@@ -0,0 +1,294 @@
+#include <cstdint>
+#include <cstring>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/OnDiskHashTable.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_SHARD_INDEX_H
+#define TYPE_EXTRACTOR_SHARD_INDEX_H
+
+// The index of a sharded extraction (`--shard-dir`), where records are split
+//  into one JSON lines file per shard. It maps the declaration ID and the type
+//  name of every record to where the record is, so that a record can be read
+//  without reading anything else. The index file is laid out as:
+//
+//   ShardIndexHeader
+//   the shard names, as NUL-terminated strings
+//   the items of the hash table
+//   the buckets of the hash table, at `tableOffset`
+//
+// The hash table is an `llvm::OnDiskChainedHashTable`, whose keys are the
+//  declaration IDs and type names (see `shardIndexIDKey` and
+//  `shardIndexNameKey`), and whose values are lists of `ShardLocation`s.
+//  The header is in the byte order of the machine that wrote the file, and
+//  the hash table is little-endian, as LLVM writes it. The shard named
+//  "Sysroot/usr" is in the file "Sysroot/usr.jsonl", next to the index.
+
+inline constexpr char shardIndexMagic[8] = {'T', 'E', 'S', 'H',
+                                            'A', 'R', 'D', 'X'};
+inline constexpr uint32_t shardIndexVersion = 1;
+inline constexpr llvm::StringLiteral shardIndexFileName = "index.teidx";
+inline constexpr llvm::StringLiteral shardFileExtension = ".jsonl";
+
+struct ShardIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t shardCount;
+  uint64_t shardNamesOffset;
+  uint64_t tableOffset;
+};
+
+static_assert(sizeof(ShardIndexHeader) == 32);
+
+// Where a record is: its shard, and the byte range of its line (without the
+//  newline) in the shard's file.
+struct ShardLocation {
+  uint32_t shard;
+  uint32_t length;
+  uint64_t offset;
+};
+
+inline constexpr uint32_t shardLocationSize = 16;
+
+// Keys of the hash table. There's one location for each ID, and one for each
+//  record with a given name (e.g. a struct and a typedef of it).
+inline std::string shardIndexIDKey(llvm::StringRef declID) {
+  return ("I" + declID).str();
+}
+inline std::string shardIndexNameKey(llvm::StringRef typeName) {
+  return ("N" + typeName).str();
+}
+
+inline uint32_t shardIndexHash(llvm::StringRef key) {
+  return uint32_t(llvm::xxh3_64bits(llvm::arrayRefFromStringRef(key)));
+}
+
+// The `llvm::OnDiskChainedHashTableGenerator` info, for writing the table.
+class ShardIndexWriterInfo {
+public:
+  using key_type = std::string;
+  using key_type_ref = const std::string &;
+  using data_type = llvm::SmallVector<ShardLocation, 1>;
+  using data_type_ref = const data_type &;
+  using hash_value_type = uint32_t;
+  using offset_type = uint32_t;
+
+  static hash_value_type ComputeHash(key_type_ref key) {
+    return shardIndexHash(key);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(llvm::raw_ostream &OS, key_type_ref key,
+                    data_type_ref data) {
+    llvm::support::endian::Writer writer(OS, llvm::endianness::little);
+    offset_type keyLength = key.size();
+    offset_type dataLength = data.size() * shardLocationSize;
+    writer.write<offset_type>(keyLength);
+    writer.write<offset_type>(dataLength);
+    return {keyLength, dataLength};
+  }
+
+  static void EmitKey(llvm::raw_ostream &OS, key_type_ref key, offset_type) {
+    OS << key;
+  }
+
+  static void EmitData(llvm::raw_ostream &OS, key_type_ref, data_type_ref data,
+                       offset_type) {
+    llvm::support::endian::Writer writer(OS, llvm::endianness::little);
+    for (const auto &location : data) {
+      writer.write<uint32_t>(location.shard);
+      writer.write<uint32_t>(location.length);
+      writer.write<uint64_t>(location.offset);
+    }
+  }
+};
+
+// The `llvm::OnDiskChainedHashTable` info, for reading the table.
+class ShardIndexReaderInfo {
+public:
+  using internal_key_type = llvm::StringRef;
+  using external_key_type = llvm::StringRef;
+  using data_type = llvm::SmallVector<ShardLocation, 1>;
+  using hash_value_type = uint32_t;
+  using offset_type = uint32_t;
+
+  static internal_key_type GetInternalKey(external_key_type key) {
+    return key;
+  }
+
+  static hash_value_type ComputeHash(internal_key_type key) {
+    return shardIndexHash(key);
+  }
+
+  static bool EqualKey(internal_key_type a, internal_key_type b) {
+    return a == b;
+  }
+
+  static std::pair<offset_type, offset_type>
+  ReadKeyDataLength(const unsigned char *&data) {
+    using namespace llvm::support;
+    auto keyLength =
+        endian::readNext<offset_type, llvm::endianness::little, unaligned>(
+            data);
+    auto dataLength =
+        endian::readNext<offset_type, llvm::endianness::little, unaligned>(
+            data);
+    return {keyLength, dataLength};
+  }
+
+  static internal_key_type ReadKey(const unsigned char *data,
+                                   offset_type length) {
+    return {reinterpret_cast<const char *>(data), length};
+  }
+
+  static data_type ReadData(internal_key_type, const unsigned char *data,
+                            offset_type length) {
+    using namespace llvm::support;
+    data_type locations;
+    for (offset_type i = 0; i < length / shardLocationSize; ++i) {
+      ShardLocation location;
+      location.shard =
+          endian::readNext<uint32_t, llvm::endianness::little, unaligned>(data);
+      location.length =
+          endian::readNext<uint32_t, llvm::endianness::little, unaligned>(data);
+      location.offset =
+          endian::readNext<uint64_t, llvm::endianness::little, unaligned>(data);
+      locations.push_back(location);
+    }
+    return locations;
+  }
+};
+
+// A validated index, mapped from disk. Lookups only touch the buckets and
+//  items they need, and reading a record only reads its line.
+class ShardIndex {
+private:
+  using Table = llvm::OnDiskChainedHashTable<ShardIndexReaderInfo>;
+
+  std::string Directory;
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  std::vector<llvm::StringRef> ShardNames;
+  std::unique_ptr<Table> Locations;
+
+  ShardIndex() = default;
+
+  bool validate() {
+    auto data =
+        reinterpret_cast<const unsigned char *>(Buffer->getBufferStart());
+    size_t size = Buffer->getBufferSize();
+    if (size < sizeof(ShardIndexHeader)) {
+      return false;
+    }
+    ShardIndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, shardIndexMagic, sizeof(shardIndexMagic)) !=
+            0 ||
+        header.version != shardIndexVersion ||
+        header.shardNamesOffset > size || header.tableOffset % 4 != 0 ||
+        header.tableOffset > size || size - header.tableOffset < 8) {
+      return false;
+    }
+
+    auto names = llvm::StringRef(
+        reinterpret_cast<const char *>(data) + header.shardNamesOffset,
+        header.tableOffset - std::min(header.tableOffset,
+                                      header.shardNamesOffset));
+    for (uint32_t i = 0; i < header.shardCount; ++i) {
+      size_t end = names.find('\0');
+      if (end == llvm::StringRef::npos) {
+        return false;
+      }
+      ShardNames.push_back(names.take_front(end));
+      names = names.drop_front(end + 1);
+    }
+
+    // Every bucket has to be within the file, before the bucket array.
+    const unsigned char *buckets = data + header.tableOffset;
+    auto [bucketCount, entryCount] =
+        Table::readNumBucketsAndEntries(buckets);
+    if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+        bucketCount > (size - header.tableOffset - 8) / 4) {
+      return false;
+    }
+    for (uint32_t i = 0; i < bucketCount; ++i) {
+      uint32_t offset = llvm::support::endian::read32le(buckets + 4 * i);
+      if (offset >= header.tableOffset) {
+        return false;
+      }
+    }
+    Locations = std::make_unique<Table>(bucketCount, entryCount, buckets, data);
+    return true;
+  }
+
+public:
+  // Open the index of the shards in `directory`.
+  static std::unique_ptr<ShardIndex> open(llvm::StringRef directory) {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, shardIndexFileName);
+    auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/false);
+    if (!buffer) {
+      return nullptr;
+    }
+    std::unique_ptr<ShardIndex> index(new ShardIndex());
+    index->Directory = directory.str();
+    index->Buffer = std::move(*buffer);
+    if (!index->validate()) {
+      return nullptr;
+    }
+    return index;
+  }
+
+  llvm::ArrayRef<llvm::StringRef> getShardNames() const { return ShardNames; }
+
+  // The record with the declaration ID, if there is one.
+  std::optional<ShardLocation> lookupID(llvm::StringRef declID) {
+    auto it = Locations->find(shardIndexIDKey(declID));
+    if (it == Locations->end()) {
+      return std::nullopt;
+    }
+    auto locations = *it;
+    if (locations.empty()) {
+      return std::nullopt;
+    }
+    return locations.front();
+  }
+
+  // The records with the type name, in the order they were written.
+  llvm::SmallVector<ShardLocation, 1> lookupName(llvm::StringRef typeName) {
+    auto it = Locations->find(shardIndexNameKey(typeName));
+    if (it == Locations->end()) {
+      return {};
+    }
+    return *it;
+  }
+
+  // Read the JSON line of a record, without reading the rest of its shard.
+  std::optional<std::string> readRecord(const ShardLocation &location) const {
+    if (location.shard >= ShardNames.size()) {
+      return std::nullopt;
+    }
+    llvm::SmallString<256> path(Directory);
+    llvm::sys::path::append(path, ShardNames[location.shard]);
+    path += shardFileExtension;
+    auto buffer = llvm::MemoryBuffer::getFileSlice(path, location.length,
+                                                   location.offset);
+    if (!buffer) {
+      return std::nullopt;
+    }
+    return (*buffer)->getBuffer().str();
+  }
+};
+
+#endif // TYPE_EXTRACTOR_SHARD_INDEX_H
@@ -1,10 +1,125 @@
+#include "AsyncOutputStream.h"
+#include "RecordSink.h"
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/Decl.h>
 #include <clang/AST/DeclGroup.h>
 #include <clang/Frontend/FrontendActions.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_ACTION_H
+#define TYPE_EXTRACTOR_ACTION_H
+
+enum class OutputFormat {
+  // One JSON object per line.
+  JSON,
+  // The format described in `BinaryFormat.h`.
+  Binary,
+  // JSON lines, with files and type names written once as table entries
+  //  that records refer to by ID.
+  NormalizedJSON,
+};
+
+// How the compiler is set up, on top of the arguments it's given.
+enum class FrontendProfile {
+  // Exactly as the arguments say.
+  Default,
+  // Only for extraction: function bodies are skipped (except in C++, where
+  //  they can instantiate the types that records describe), and only errors
+  //  are reported (briefly). The records are the same. Nothing that affects
+  //  code generation is touched, but this is for the standalone executable,
+  //  not the plugin.
+  Extract,
+};
+
+// Which files declarations are extracted from. Declarations in other files are
+//  skipped during traversal (along with everything inside them), and only
+//  emitted if a record that is kept references them.
+struct ExtractorFilters {
+  // Globs matched against the absolute path of the declaring file (where `*`
+  //  also matches `/`). If there are any, the file must match one of them or
+  //  be in one of `includePseudoRoots`.
+  std::vector<std::string> includePaths;
+  std::vector<std::string> excludePaths;
+  // Pseudo-roots of the declaring file ("Sysroot", "ResourceDir" or
+  //  "Unknown"), which work like the paths above.
+  std::vector<std::string> includePseudoRoots;
+  std::vector<std::string> excludePseudoRoots;
+
+  bool empty() const {
+    return includePaths.empty() && excludePaths.empty() &&
+           includePseudoRoots.empty() && excludePseudoRoots.empty();
+  }
+};
+
+struct ExtractorOptions {
+  // Only applies when writing to stdout (without a record handler or sink).
+  OutputFormat outputFormat = OutputFormat::JSON;
+  // Also only for stdout. With either of these, the output is written by a
+  //  separate thread, so extraction doesn't wait on a slow consumer.
+  bool asyncOutput = false;
+  OutputCompression outputCompression = OutputCompression::None;
+  // Also only for stdout. If set, the records are written as JSON lines to
+  //  shards in this directory instead, along with an index of them (see
+  //  `ShardIndex.h`).
+  std::optional<std::string> shardDirectory;
+  // Also only for stdout. If set, the records are written as JSON lines to a
+  //  file of their own in this directory (see `OutputDirectoryWriter.h`),
+  //  which the translation units of a build share.
+  std::optional<std::string> outputDirectory;
+  // If set, definitions whose IDs are already in this store (see
+  //  `DedupStore.h`) are skipped, and the others are added to it, so that
+  //  concurrent compilers each write different types.
+  std::optional<std::string> dedupStorePath;
+  // If set, records are cached in this file and replayed on later runs for
+  //  declarations whose files (and everything before them) are unchanged.
+  //  Requires a `SerializedRecordSink`.
+  std::optional<std::string> incrementalCachePath;
+  ExtractorFilters filters;
+  // If not empty, only the file-scope declarations with these names are
+  //  emitted, along with everything they reference (transitively, including
+  //  through pointers), instead of the whole translation unit.
+  std::vector<std::string> rootNames;
+  // Time the phases of the extraction, and print them to stderr along with
+  //  the other stats.
+  bool collectStats = false;
+  // With anything but 1, records are serialized on this many threads (or
+  //  one per core, for 0) while the extraction goes on, instead of on the
+  //  extraction thread. Requires a `SerializedRecordSink`.
+  unsigned serializationThreads = 1;
+  FrontendProfile frontendProfile = FrontendProfile::Default;
+};
 
 class TypeExtractorAction : public clang::ASTFrontendAction {
+private:
+  RecordHandler Handler;
+  RecordSink *Sink = nullptr;
+  ExtractorOptions Options;
+  // The stream in front of stdout, for asynchronous output.
+  std::unique_ptr<AsyncOutputStream> OwnedStream;
+  // The sink for `Handler` or stdout, when not given one.
+  std::unique_ptr<RecordSink> OwnedSink;
+
 public:
+  // With no handler, records are written to stdout.
+  TypeExtractorAction() = default;
+  explicit TypeExtractorAction(RecordHandler handler,
+                               ExtractorOptions options = {})
+      : Handler(std::move(handler)), Options(std::move(options)) {}
+  // The sink must outlive the action.
+  explicit TypeExtractorAction(RecordSink &sink, ExtractorOptions options = {})
+      : Sink(&sink), Options(std::move(options)) {}
+
   std::unique_ptr<clang::ASTConsumer>
   CreateASTConsumer(clang::CompilerInstance &CI, llvm::StringRef file) override;
-};
\ No newline at end of file
+
+protected:
+  ExtractorOptions &getOptions() { return Options; }
+
+  // Applies the frontend profile.
+  bool BeginInvocation(clang::CompilerInstance &CI) override;
+};
+
+#endif // TYPE_EXTRACTOR_ACTION_H
@@ -0,0 +1,137 @@
+#include "AsyncOutputStream.h"
+#include "DependencyOrder.h"
+#include "ExtractionStats.h"
+#include "RecordSink.h"
+#include "TypeExtractorAction.h"
+#include "TypeRecord.h"
+#include <chrono>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/GlobPattern.h>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_SESSION_H
+#define TYPE_EXTRACTOR_SESSION_H
+
+class DedupStore;
+class IncrementalCache;
+class ParallelSerializer;
+class TypeCache;
+struct CachePosition;
+
+// The extraction of one translation unit. All of the extraction state lives
+//  here, so any number of sessions can run at once, on any threads, as long
+//  as each has its own `CompilerInstance`.
+class TypeExtractorSession : public clang::ASTConsumer {
+  friend class TypeExtractorVisitor;
+
+private:
+  RecordSink &Sink;
+  ExtractorOptions Options;
+  std::string Sysroot;
+  std::string ResourceDir;
+  std::unique_ptr<IncrementalCache> Cache;
+  // Declaration IDs claimed by the processes of a build, if shared.
+  std::unique_ptr<DedupStore> Dedup;
+  // Hash of the name of the output, which owns the IDs it claims.
+  uint64_t DedupOwner = 0;
+  // Serializes records off the extraction thread, if enabled.
+  std::unique_ptr<ParallelSerializer> Serializer;
+  std::map<llvm::StringRef, llvm::SmallVector<llvm::StringRef, 16>>
+      PathComponents;
+  // Declaration IDs that have been claimed for emission (and own the storage
+  //  that `ScheduledDecl::declID` points to).
+  llvm::StringSet<> ProcessedDeclIDs;
+  std::vector<llvm::GlobPattern> IncludePaths;
+  std::vector<llvm::GlobPattern> ExcludePaths;
+  // Whether each file passes the filters, by file ID.
+  llvm::DenseMap<clang::FileID, bool> FilteredFiles;
+  ExtractionStats Stats;
+  // Where phases are timed, which is only done if stats are requested.
+  ExtractionStats *PhaseStats;
+  std::chrono::steady_clock::time_point CreationTime;
+  // Spellings and sizes of the types records reference.
+  std::unique_ptr<TypeCache> Types;
+  // Hashes of the records emitted so far, by declaration ID.
+  llvm::StringMap<uint64_t> RecordHashes;
+  // The records that the current record's hash covers, with their hashes,
+  //  if there's an incremental cache.
+  std::vector<std::pair<llvm::StringRef, std::optional<uint64_t>>>
+      RecordReferences;
+  // Declarations whose records were replayed from the cache, which don't
+  //  need to be traversed.
+  llvm::DenseSet<const clang::Decl *> ReplayedDecls;
+  // The stream the sink writes to, if it's asynchronous.
+  AsyncOutputStream *OutputStream = nullptr;
+
+  // A declaration that has been claimed for emission.
+  struct ScheduledDecl {
+    clang::NamedDecl *decl;
+    llvm::StringRef declID;
+    llvm::StringRef filePath;
+  };
+  // Scratch space for scheduling, reused between declarations: the
+  //  declarations claimed so far (numbered in the order they were claimed),
+  //  their numbers by canonical declaration, and the order to emit them in.
+  std::vector<ScheduledDecl> Scheduled;
+  llvm::DenseMap<const clang::Decl *, unsigned> ScheduledNodes;
+  DependencyOrder Order;
+  std::vector<ScheduledDecl> EmitOrder;
+
+  // Scratch space for building and serializing records, reused between
+  //  records so that extraction doesn't allocate once it's warmed up.
+  llvm::BumpPtrAllocator RecordAllocator;
+  TypeRecord CurrentRecord;
+  llvm::SmallString<1024> RecordJSON;
+
+  void emitRecord(const TypeRecord &record, llvm::StringRef filePath,
+                  const CachePosition &cachePosition);
+  llvm::ArrayRef<llvm::StringRef> getPathComponents(llvm::StringRef filePath);
+  bool isFileIncluded(const clang::SourceManager &SM, clang::FileID file);
+  bool isClaimedElsewhere(llvm::StringRef declID, bool isDefinition);
+  bool shouldTraverseDecl(clang::Decl *D);
+  std::optional<ScheduledDecl> claimDecl(clang::NamedDecl *D, bool parseAnyway);
+  void emitScheduledDecl(const ScheduledDecl &scheduled);
+  // Emit a declaration, after any of the types it references that haven't
+  //  been emitted yet.
+  bool emitTypeDecl(clang::NamedDecl *D, bool parseAnyway = false);
+  void emitRoots(clang::ASTContext &Context);
+
+public:
+  TypeExtractorSession(clang::CompilerInstance &CI, RecordSink &sink,
+                       ExtractorOptions options = {});
+  ~TypeExtractorSession() override;
+
+  void HandleTranslationUnit(clang::ASTContext &Context) override;
+
+  // Wait for the sink's asynchronous output to be written at the end of each
+  //  translation unit, and count the time spent blocked on it.
+  void setOutputStream(AsyncOutputStream *stream) { OutputStream = stream; }
+
+  // Name the output that records are written to, which owns the IDs claimed
+  //  in the dedup store, so that rebuilding it writes them again.
+  void setOutputName(llvm::StringRef outputName);
+
+  // Stats of the last translation unit.
+  const ExtractionStats &getStats() const { return Stats; }
+};
+
+// Parse `code` as a header with the given Clang arguments, and send its
+//  records to `sink`. Returns false if Clang failed.
+bool extractTypesFromCode(RecordSink &sink, llvm::StringRef code,
+                          const std::vector<std::string> &args,
+                          ExtractorOptions options = {},
+                          llvm::StringRef fileName = "header.h");
+
+#endif // TYPE_EXTRACTOR_SESSION_H
@@ -0,0 +1,117 @@
+#include <cstdint>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/raw_ostream.h>
+#include <optional>
+
+#ifndef TYPE_EXTRACTOR_TYPE_RECORD_H
+#define TYPE_EXTRACTOR_TYPE_RECORD_H
+
+// Plain-data description of one extracted declaration. Strings are not owned
+//  by the record; they point into Clang's AST or into storage kept alive by
+//  whoever built the record, for at least as long as the record is in use.
+
+// A reference to a type: the ID of its declaration (if it has one we emit),
+//  and how it's spelled.
+struct DeclIDAndTypeName {
+  std::optional<llvm::StringRef> declID;
+  llvm::StringRef typeName;
+};
+
+// A union member or function parameter.
+struct NamedType {
+  llvm::StringRef name;
+  DeclIDAndTypeName type;
+};
+
+struct StructField {
+  llvm::StringRef name;
+  // Both in bits.
+  int64_t offset;
+  int64_t size;
+  DeclIDAndTypeName type;
+};
+
+struct EnumEntry {
+  llvm::StringRef name;
+  uint64_t value;
+};
+
+enum class TypeKind { Typedef, Struct, Union, Enum, Function };
+
+inline llvm::StringRef typeKindName(TypeKind kind) {
+  switch (kind) {
+  case TypeKind::Typedef:
+    return "Typedef";
+  case TypeKind::Struct:
+    return "Struct";
+  case TypeKind::Union:
+    return "Union";
+  case TypeKind::Enum:
+    return "Enum";
+  case TypeKind::Function:
+    return "Function";
+  }
+  return "Unknown"; // Fallback, should not be reached.
+}
+
+struct TypeRecord {
+  TypeKind kind = TypeKind::Typedef;
+  // The declaration itself. Its ID is always set.
+  DeclIDAndTypeName type;
+  // False for records that are only forward-declared in this TU.
+  bool isDefinition = true;
+  llvm::StringRef pseudoRoot;
+  // Path components of the declaring file, relative to the pseudo-root.
+  llvm::SmallVector<llvm::StringRef, 16> location;
+  // Structural hash, from `hashTypeRecord`.
+  uint64_t hash = 0;
+
+  // Kind-specific properties, only meaningful for the kinds noted.
+  DeclIDAndTypeName underlyingType;       // Typedef
+  llvm::SmallVector<StructField> fields;  // Struct
+  llvm::SmallVector<NamedType> members;   // Union
+  DeclIDAndTypeName backingType;          // Enum
+  llvm::SmallVector<EnumEntry> entries;   // Enum
+  DeclIDAndTypeName returnType;           // Function
+  llvm::SmallVector<NamedType> params;    // Function
+
+  // Reset for reuse, keeping any allocated capacity.
+  void clear() {
+    kind = TypeKind::Typedef;
+    type = {};
+    isDefinition = true;
+    pseudoRoot = {};
+    location.clear();
+    hash = 0;
+    underlyingType = {};
+    fields.clear();
+    members.clear();
+    backingType = {};
+    entries.clear();
+    returnType = {};
+    params.clear();
+  }
+};
+
+// Hash the structure of the record: its kind, name, properties and layout,
+//  along with the hash of each record it references, as given by
+//  `getReferencedHash` (so that a change to a type also changes the hash of
+//  everything that references it). References without a hash (which only
+//  happens in cycles) are hashed by their declaration ID instead. Where the
+//  record is declared doesn't count.
+uint64_t hashTypeRecord(
+    const TypeRecord &record,
+    llvm::function_ref<std::optional<uint64_t>(llvm::StringRef)>
+        getReferencedHash);
+
+// Copy the record, along with the strings it points to (into `saver`).
+TypeRecord copyTypeRecord(const TypeRecord &record, llvm::StringSaver &saver);
+
+// Write the record as a single line of JSON (without the trailing newline),
+//  exactly as the extractor would.
+void writeTypeRecordJSON(llvm::raw_ostream &OS, const TypeRecord &record);
+
+#endif // TYPE_EXTRACTOR_TYPE_RECORD_H
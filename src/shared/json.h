@@ -1,191 +1,203 @@
-#include <cassert>
-#include <cstdint>
-#include <format>
-#include <map>
-#include <string>
-#include <vector>
+#include "TypeRecord.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
 
 #ifndef TYPE_EXTRACTOR_JSON_H
 #define TYPE_EXTRACTOR_JSON_H
 
-inline std::string
-json_from_map(const std::map<std::string, std::string> &properties) {
-  std::string json = "{";
-  for (const auto &pair : properties) {
-    json += std::format(R"("{}":"{}",)", pair.first, pair.second);
-  }
-  if (!properties.empty()) {
-    json.pop_back(); // Remove the last comma
-  }
-  json += "}";
-  return json;
-}
-
-inline std::string json_from_vector(const std::vector<std::string> &elements) {
-  std::string json = "[";
-  for (const auto &element : elements) {
-    json += std::format(R"("{}",)", element);
-  }
-  if (!elements.empty()) {
-    json.pop_back(); // Remove the last comma
-  }
-  json += "]";
-  return json;
+// Records are streamed straight into the output with `llvm::json::OStream`,
+//  which takes care of escaping and never builds intermediate strings.
+
+// For the normalized format, where type names and files are written as IDs
+//  of table entries emitted earlier.
+struct JSONTableIDs {
+  llvm::function_ref<uint64_t(llvm::StringRef)> typeNameID;
+  uint64_t fileID;
+};
+
+inline void json_decl_id_and_type_name(llvm::json::OStream &J,
+                                       const DeclIDAndTypeName &type,
+                                       const JSONTableIDs *tables) {
+  J.object([&] {
+    if (type.declID) {
+      J.attribute("declID", *type.declID);
+    } else {
+      J.attribute("declID", nullptr);
+    }
+    if (tables) {
+      J.attribute("typeName", tables->typeNameID(type.typeName));
+    } else {
+      J.attribute("typeName", type.typeName);
+    }
+  });
 }
 
-typedef std::pair<std::optional<std::string>, std::string> DeclIDAndTypeName;
-inline std::string
-json_decl_id_and_type_name(const DeclIDAndTypeName &declIDAndTypeName) {
-  const auto &declID = declIDAndTypeName.first;
-  const auto &typeName = declIDAndTypeName.second;
-  return declID ? std::format(R"({{"declID":"{}","typeName":"{}"}})", *declID,
-                              typeName)
-                : std::format(R"({{"declID":null,"typeName":"{}"}})", typeName);
+inline void json_named_types(llvm::json::OStream &J,
+                             llvm::ArrayRef<NamedType> types,
+                             const JSONTableIDs *tables) {
+  J.array([&] {
+    for (const auto &type : types) {
+      J.object([&] {
+        J.attribute("name", type.name);
+        J.attributeBegin("type");
+        json_decl_id_and_type_name(J, type.type, tables);
+        J.attributeEnd();
+      });
+    }
+  });
 }
 
-typedef std::vector<std::pair<std::string, DeclIDAndTypeName>> OrderedTypesMap;
-
-inline std::string json_ordered_types_map(const OrderedTypesMap &types) {
-  std::string json = "[";
-  for (const auto &pair : types) {
-    auto typeIDAndName = json_decl_id_and_type_name(pair.second);
-    json +=
-        std::format(R"({{"name":"{}","type":{}}},)", pair.first, typeIDAndName);
-  }
-  if (!types.empty()) {
-    json.pop_back(); // Remove the last comma
-  }
-  json += "]";
-  return json;
+inline void json_struct_fields(llvm::json::OStream &J,
+                               llvm::ArrayRef<StructField> fields,
+                               const JSONTableIDs *tables) {
+  J.array([&] {
+    for (const auto &field : fields) {
+      J.object([&] {
+        J.attribute("name", field.name);
+        J.attributeObject("field", [&] {
+          J.attribute("offset", field.offset);
+          J.attribute("size", field.size);
+          J.attributeBegin("type");
+          json_decl_id_and_type_name(J, field.type, tables);
+          J.attributeEnd();
+        });
+      });
+    }
+  });
 }
 
-inline std::string json_type_decl(const std::string &kind,
-                                  const DeclIDAndTypeName &declIDAndTypeName,
-                                  std::string &properties,
-                                  const std::string &pseudoRoot,
-                                  const std::vector<std::string> &location) {
-  const auto declIDAndTypeNameStr =
-      json_decl_id_and_type_name(declIDAndTypeName);
-  assert(properties.front() == '{' &&
-         "Properties should start with '{' for JSON formatting");
-  // This should be a JSON object string, so we replace '{' with
-  // '{"kind":"<kind>",' to add "kind" as the first property.
-  // HACK: This is a bit fragile, but it works for our use case.
-  properties.replace(properties.find('{'), 1,
-                     std::format(R"({{"kind":"{}",)", kind));
-  return std::format(
-      R"({{"type":{},"properties":{},"pseudoRoot":"{}","location":{}}})",
-      declIDAndTypeNameStr, properties, pseudoRoot, json_from_vector(location));
+inline void json_enum_entries(llvm::json::OStream &J,
+                              llvm::ArrayRef<EnumEntry> entries) {
+  J.array([&] {
+    for (const auto &entry : entries) {
+      J.object([&] {
+        J.attribute("name", entry.name);
+        J.attribute("value", entry.value);
+      });
+    }
+  });
 }
 
-inline std::string
-json_typdef_decl(const DeclIDAndTypeName &declIDAndTypeName,
-                 const DeclIDAndTypeName &underlyingDeclIDAndTypeName,
-                 const std::string &pseudoRoot,
-                 const std::vector<std::string> &location) {
-  // TODO: Determine if we should parse the type string further.
-  auto declIDAndTypeNameStr = json_decl_id_and_type_name(declIDAndTypeName);
-  auto underlyingDeclIDAndTypeNameStr =
-      json_decl_id_and_type_name(underlyingDeclIDAndTypeName);
-  auto properties =
-      std::format(R"({{"underlyingType":{}}})", underlyingDeclIDAndTypeNameStr);
-  return json_type_decl("Typedef", declIDAndTypeName, properties, pseudoRoot,
-                        location);
-}
-
-typedef std::tuple<int64_t, int64_t, DeclIDAndTypeName> StructField;
-inline std::string json_struct_field(const StructField &field) {
-  auto [offset, size, declIDAndTypeName] = field;
-  auto declIDAndTypeNameStr = json_decl_id_and_type_name(declIDAndTypeName);
-  return std::format(R"({{"offset":{},"size":{},"type":{}}})", offset, size,
-                     declIDAndTypeNameStr);
-}
-
-inline std::string json_struct_fields(
-    const std::vector<std::pair<std::string, StructField>> &fields) {
-  if (fields.empty()) {
-    return "[]"; // Return empty array if no fields
+// Write the kind-specific properties of the record, with "kind" first.
+inline void json_type_properties(llvm::json::OStream &J,
+                                 const TypeRecord &record,
+                                 const JSONTableIDs *tables) {
+  J.attribute("kind", typeKindName(record.kind));
+  switch (record.kind) {
+  case TypeKind::Typedef:
+    // TODO: Determine if we should parse the type string further.
+    J.attributeBegin("underlyingType");
+    json_decl_id_and_type_name(J, record.underlyingType, tables);
+    J.attributeEnd();
+    break;
+  case TypeKind::Struct:
+    J.attributeBegin("fields");
+    json_struct_fields(J, record.fields, tables);
+    J.attributeEnd();
+    break;
+  case TypeKind::Union:
+    J.attributeBegin("members");
+    json_named_types(J, record.members, tables);
+    J.attributeEnd();
+    break;
+  case TypeKind::Enum:
+    J.attributeBegin("backingType");
+    json_decl_id_and_type_name(J, record.backingType, tables);
+    J.attributeEnd();
+    J.attributeBegin("entries");
+    json_enum_entries(J, record.entries);
+    J.attributeEnd();
+    break;
+  case TypeKind::Function:
+    J.attributeBegin("returnType");
+    json_decl_id_and_type_name(J, record.returnType, tables);
+    J.attributeEnd();
+    J.attributeBegin("params");
+    json_named_types(J, record.params, tables);
+    J.attributeEnd();
+    break;
   }
-  std::vector<std::string> fieldJsons(fields.size());
-  std::transform(fields.begin(), fields.end(), fieldJsons.begin(),
-                 [](const std::pair<std::string, StructField> &pair) {
-                   return std::format(R"("name":"{}","field":{})", pair.first,
-                                      json_struct_field(pair.second));
-                 });
-  std::string json = "[";
-  for (const auto &fieldJson : fieldJsons) {
-    json += std::format(R"({{{}}},)", fieldJson);
-  }
-  json.pop_back(); // Remove the last comma
-  json += "]";
-  return json;
 }
 
-inline std::string
-json_struct_decl(const DeclIDAndTypeName &declIDAndTypeName,
-                 std::vector<std::pair<std::string, StructField>> &fields,
-                 const std::string &pseudoRoot,
-                 const std::vector<std::string> &location) {
-  auto properties =
-      std::format(R"({{"fields":{}}})", json_struct_fields(fields));
-  return json_type_decl("Struct", declIDAndTypeName, properties, pseudoRoot,
-                        location);
+// Hashes are written as 16 hex digits, as JSON numbers can't be relied on to
+//  hold 64 bits.
+inline std::string json_hash(uint64_t hash) {
+  return llvm::utohexstr(hash, /*LowerCase=*/true, /*Width=*/16);
 }
 
-inline std::string json_union_decl(const DeclIDAndTypeName &declIDAndTypeName,
-                                   const OrderedTypesMap &members,
-                                   const std::string &pseudoRoot,
-                                   const std::vector<std::string> &location) {
-  auto properties =
-      std::format(R"({{"members":{}}})", json_ordered_types_map(members));
-  return json_type_decl("Union", declIDAndTypeName, properties, pseudoRoot,
-                        location);
+// Write the attributes of a record, inside an object that's already begun.
+inline void json_type_record_attributes(llvm::json::OStream &J,
+                                        const TypeRecord &record,
+                                        const JSONTableIDs *tables) {
+  J.attributeBegin("type");
+  json_decl_id_and_type_name(J, record.type, tables);
+  J.attributeEnd();
+  J.attribute("hash", json_hash(record.hash));
+  J.attributeObject("properties",
+                    [&] { json_type_properties(J, record, tables); });
+  if (tables) {
+    J.attribute("file", tables->fileID);
+    return;
+  }
+  J.attribute("pseudoRoot", record.pseudoRoot);
+  J.attributeArray("location", [&] {
+    for (const auto &component : record.location) {
+      J.value(component);
+    }
+  });
 }
 
-typedef std::pair<std::string, uint64_t> EnumEntry;
-
-inline std::string json_enum_entry(const EnumEntry &entry) {
-  return std::format(R"({{"name":"{}","value":{}}})", entry.first,
-                     entry.second);
+// Write the record as a single line of JSON (without the trailing newline).
+//  With `tables`, the declaring file and type names are written as IDs.
+inline void json_type_record(llvm::raw_ostream &OS, const TypeRecord &record,
+                             const JSONTableIDs *tables = nullptr) {
+  llvm::json::OStream J(OS);
+  J.object([&] { json_type_record_attributes(J, record, tables); });
 }
 
-typedef std::vector<EnumEntry> EnumEntries;
-
-inline std::string json_enum_entries(const EnumEntries &entries) {
-  if (entries.empty()) {
-    return "[]"; // Return empty array if no entries
-  }
-  std::string json = "[";
-  for (const auto &entry : entries) {
-    json += std::format(R"({},)", json_enum_entry(entry));
-  }
-  json.pop_back(); // Remove the last comma
-  json += "]";
-  return json;
+// Write the offsets and sizes of the fields of a struct, in field order.
+inline void json_field_layouts(llvm::json::OStream &J,
+                               llvm::ArrayRef<StructField> fields) {
+  J.array([&] {
+    for (const auto &field : fields) {
+      J.object([&] {
+        J.attribute("offset", field.offset);
+        J.attribute("size", field.size);
+      });
+    }
+  });
 }
 
-inline std::string json_enum_decl(const DeclIDAndTypeName &declIDAndTypeName,
-                                  const DeclIDAndTypeName &backingType,
-                                  const EnumEntries &entries,
-                                  const std::string &pseudoRoot,
-                                  const std::vector<std::string> &location) {
-  auto properties = std::format(R"({{"backingType":{},"entries":{}}})",
-                                json_decl_id_and_type_name(backingType),
-                                json_enum_entries(entries));
-  return json_type_decl("Enum", declIDAndTypeName, properties, pseudoRoot,
-                        location);
+// Write a file table entry of the normalized format.
+inline void json_file_table_entry(llvm::raw_ostream &OS, uint64_t id,
+                                  llvm::StringRef pseudoRoot,
+                                  llvm::ArrayRef<llvm::StringRef> location) {
+  llvm::json::OStream J(OS);
+  J.object([&] {
+    J.attributeObject("file", [&] {
+      J.attribute("id", id);
+      J.attribute("pseudoRoot", pseudoRoot);
+      J.attributeArray("location", [&] {
+        for (const auto &component : location) {
+          J.value(component);
+        }
+      });
+    });
+  });
 }
 
-inline std::string
-json_function_decl(const DeclIDAndTypeName &declIDAndTypeName,
-                   const DeclIDAndTypeName &returnType,
-                   const OrderedTypesMap &params, const std::string &pseudoRoot,
-                   const std::vector<std::string> &location) {
-  auto properties = std::format(R"({{"returnType":{},"params":{}}})",
-                                json_decl_id_and_type_name(returnType),
-                                json_ordered_types_map(params));
-  return json_type_decl("Function", declIDAndTypeName, properties, pseudoRoot,
-                        location);
+// Write a type name table entry of the normalized format.
+inline void json_type_name_table_entry(llvm::raw_ostream &OS, uint64_t id,
+                                       llvm::StringRef typeName) {
+  llvm::json::OStream J(OS);
+  J.object([&] {
+    J.attributeObject("typeName", [&] {
+      J.attribute("id", id);
+      J.attribute("typeName", typeName);
+    });
+  });
 }
 
-#endif // TYPE_EXTRACTOR_JSON_H
\ No newline at end of file
+#endif // TYPE_EXTRACTOR_JSON_H
@@ -1,7 +1,13 @@
-#include "json.h"
+#include "TypeRecord.h"
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/Decl.h>
 #include <clang/AST/DeclCXX.h>
+#include <clang/Index/USRGeneration.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/raw_ostream.h>
 #include <optional>
 #include <string>
 
@@ -43,11 +49,127 @@ inline bool shouldParseDecl(const clang::NamedDecl *D) {
   return true;
 }
 
-inline DeclIDAndTypeName typeToDeclIDAndTypeName(const clang::QualType &QT) {
-  const auto D = qualTypeToDeclPtr(QT);
-  std::optional<std::string> declID =
-      D ? std::make_optional(std::to_string(D.value()->getID())) : std::nullopt;
-  return {declID, QT.getAsString()};
+// Get an ID for the declaration that is stable across translation units, so
+//  that the same type seen from different headers can be deduplicated.
+inline void getDeclStableID(const clang::Decl *D,
+                            llvm::SmallVectorImpl<char> &buffer) {
+  // The anonymous structs and unions of a record all get the same USR (e.g.
+  //  `c:@S@Outer@Ua`), so they're told apart by the index of the unnamed
+  //  field that holds them, like Clang does for named fields with `@FI@`.
+  auto RD = llvm::dyn_cast<clang::RecordDecl>(D);
+  auto parent = RD && RD->isAnonymousStructOrUnion()
+                    ? llvm::dyn_cast<clang::RecordDecl>(RD->getDeclContext())
+                    : nullptr;
+  if (parent) {
+    getDeclStableID(parent, buffer);
+    unsigned index = 0;
+    for (const clang::FieldDecl *field : parent->fields()) {
+      if (field->isAnonymousStructOrUnion() &&
+          field->getType()->getAsRecordDecl() == RD) {
+        break;
+      }
+      ++index;
+    }
+    llvm::raw_svector_ostream OS(buffer);
+    OS << "@FI@" << index << (RD->isUnion() ? "@Ua" : "@Sa");
+    return;
+  }
+
+  buffer.clear();
+  if (clang::index::generateUSRForDecl(D, buffer)) {
+    // No USR for this declaration, fall back to the (TU-local) numeric ID.
+    buffer.clear();
+    llvm::raw_svector_ostream OS(buffer);
+    OS << "#" << D->getID();
+  }
+}
+
+// Get the name of the declaration, only copying it into `saver` if it isn't a
+//  plain identifier (which Clang already keeps around).
+inline llvm::StringRef getDeclName(const clang::NamedDecl *D,
+                                   llvm::StringSaver &saver) {
+  if (const clang::IdentifierInfo *II = D->getIdentifier()) {
+    return II->getName();
+  }
+  llvm::SmallString<64> buffer;
+  llvm::raw_svector_ostream OS(buffer);
+  OS << D->getDeclName();
+  return saver.save(buffer.str());
+}
+
+// The policy `QualType::getAsString()` uses, built only once.
+inline const clang::PrintingPolicy &getTypePrintingPolicy() {
+  static const clang::PrintingPolicy policy{clang::LangOptions()};
+  return policy;
+}
+
+inline DeclIDAndTypeName typeToDeclIDAndTypeName(const clang::QualType &QT,
+                                                 llvm::StringSaver &saver) {
+  llvm::SmallString<128> buffer;
+  DeclIDAndTypeName result;
+  if (const auto D = qualTypeToDeclPtr(QT)) {
+    getDeclStableID(D.value(), buffer);
+    result.declID = saver.save(buffer.str());
+  }
+  buffer.clear();
+  llvm::raw_svector_ostream OS(buffer);
+  QT.print(OS, getTypePrintingPolicy());
+  result.typeName = saver.save(buffer.str());
+  return result;
+}
+
+// Call `fn` with the typedef and tag declarations that `QT` is built from,
+//  looking through pointers (including block and member pointers),
+//  references, arrays, vectors, atomics and function types, and whether
+//  each one is referenced by value (i.e. not through a pointer or
+//  reference). Typedefs aren't looked through, as their declarations
+//  reference the rest.
+template <typename Fn>
+void forEachReferencedDecl(clang::QualType QT, Fn &&fn) {
+  llvm::SmallVector<std::pair<clang::QualType, bool>, 4> worklist = {
+      {QT, true}};
+  while (!worklist.empty()) {
+    auto [type, byValue] = worklist.pop_back_val();
+    if (type.isNull()) {
+      continue;
+    }
+    const clang::Type *T = type.getTypePtr();
+    if (auto TT = llvm::dyn_cast<clang::TypedefType>(T)) {
+      fn(static_cast<clang::NamedDecl *>(TT->getDecl()), byValue);
+    } else if (auto TT = llvm::dyn_cast<clang::TagType>(T)) {
+      fn(static_cast<clang::NamedDecl *>(TT->getDecl()), byValue);
+    } else if (auto PT = llvm::dyn_cast<clang::PointerType>(T)) {
+      worklist.push_back({PT->getPointeeType(), false});
+    } else if (auto RT = llvm::dyn_cast<clang::ReferenceType>(T)) {
+      worklist.push_back({RT->getPointeeType(), false});
+    } else if (auto BPT = llvm::dyn_cast<clang::BlockPointerType>(T)) {
+      worklist.push_back({BPT->getPointeeType(), false});
+    } else if (auto MPT = llvm::dyn_cast<clang::MemberPointerType>(T)) {
+      worklist.push_back({MPT->getPointeeType(), false});
+      worklist.push_back({clang::QualType(MPT->getClass(), 0), false});
+    } else if (auto AT = llvm::dyn_cast<clang::AtomicType>(T)) {
+      worklist.push_back({AT->getValueType(), byValue});
+    } else if (auto AT = llvm::dyn_cast<clang::ArrayType>(T)) {
+      worklist.push_back({AT->getElementType(), byValue});
+    } else if (auto VT = llvm::dyn_cast<clang::VectorType>(T)) {
+      worklist.push_back({VT->getElementType(), byValue});
+    } else if (auto FT = llvm::dyn_cast<clang::FunctionType>(T)) {
+      // Pushed in reverse, so they're reported in declaration order.
+      if (auto FPT = llvm::dyn_cast<clang::FunctionProtoType>(FT)) {
+        for (auto paramType : llvm::reverse(FPT->param_types())) {
+          worklist.push_back({paramType, byValue});
+        }
+      }
+      worklist.push_back({FT->getReturnType(), byValue});
+    } else {
+      // Strip one layer of sugar (e.g. `struct` elaboration or parentheses),
+      //  stopping once there's none left.
+      auto desugared = T->getLocallyUnqualifiedSingleStepDesugaredType();
+      if (desugared.getTypePtr() != T) {
+        worklist.push_back({desugared, byValue});
+      }
+    }
+  }
 }
 
 #endif // TYPE_EXTRACTOR_UTIL_H
\ No newline at end of file
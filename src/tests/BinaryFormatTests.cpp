@@ -0,0 +1,57 @@
+#include "BinaryReader.h"
+#include "BinaryWriter.h"
+#include "Tests.h"
+#include "TypeExtractorSession.h"
+#include <cstring>
+#include <llvm/ADT/SmallString.h>
+
+static const char *binaryFixture = R"(
+typedef unsigned int u32;
+struct Forward;
+struct Node {
+  u32 id;
+  const char *name;
+  struct Node *next;
+  struct Forward *forward;
+  union { int i; float f; } value;
+  unsigned flags : 3;
+  char data[16];
+};
+union Number { int i; double d; };
+enum Mode { ModeOff, ModeOn = 5, ModeLast = 0xffffffffu };
+typedef void (*Callback)(struct Node *, enum Mode);
+int process(struct Node *node, Callback callback, union Number number);
+)";
+
+// Both formats carry the same information, so reading the binary output back
+//  gives the same JSON lines as the default output.
+void testBinaryMatchesJSON() {
+  auto expected = extractJSON(binaryFixture, {});
+
+  llvm::SmallString<4096> binary;
+  {
+    llvm::raw_svector_ostream OS(binary);
+    BinaryWriter writer(OS);
+    check(extractTypesFromCode(writer, binaryFixture, {}),
+          "binary extraction failed");
+  }
+  // The reader needs the file to be 8-byte aligned.
+  std::vector<uint64_t> aligned((binary.size() + 7) / 8);
+  std::memcpy(aligned.data(), binary.data(), binary.size());
+  auto file = BinaryTypeFile::fromBuffer(aligned.data(), binary.size());
+  if (!file) {
+    check(false, "the binary output isn't valid");
+    return;
+  }
+
+  std::string actual;
+  llvm::raw_string_ostream OS(actual);
+  for (const auto view : *file) {
+    writeTypeRecordJSON(OS, readBinaryRecord(*file, view));
+    OS << "\n";
+  }
+  OS.flush();
+  check(!expected.empty(), "nothing was extracted");
+  check(actual == expected, "the binary output differs:\n" + actual +
+                                "\nfrom the JSON output:\n" + expected);
+}
@@ -0,0 +1,31 @@
+#include "DedupStore.h"
+#include "Tests.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+// An ID is only claimed once across outputs, but its owner can claim it
+//  again (when it's rebuilt), even through another opening of the store.
+void testDedupStoreOwners() {
+  llvm::SmallString<128> directory;
+  if (llvm::sys::fs::createUniqueDirectory("te-tests", directory)) {
+    check(false, "can't create a temporary directory");
+    return;
+  }
+  auto path = (directory + "/store").str();
+  {
+    auto store = DedupStore::open(path);
+    check(store != nullptr, "can't open the store");
+    if (store) {
+      check(store->claim("c:@S@A", 1), "A isn't new");
+      check(!store->claim("c:@S@A", 2), "A is claimed by a second owner");
+      check(store->claim("c:@S@B", 2), "B isn't new");
+    }
+  }
+  auto reopened = DedupStore::open(path);
+  check(reopened != nullptr, "can't reopen the store");
+  if (reopened) {
+    check(reopened->claim("c:@S@A", 1), "A isn't claimed again by its owner");
+    check(!reopened->claim("c:@S@B", 1), "B is claimed by another owner");
+  }
+  llvm::sys::fs::remove_directories(directory);
+}
@@ -0,0 +1,133 @@
+#include "TypeExtractorSession.h"
+#include "Tests.h"
+#include <llvm/ADT/STLExtras.h>
+
+// Anonymous structs and unions get an ID of their own (even though Clang
+//  gives the ones in a record the same USR), which the fields holding them
+//  refer to.
+void testAnonymousRecordIDs() {
+  CollectingSink sink;
+  check(extractTypesFromCode(sink, R"(
+struct Outer {
+  union { int a; float b; };
+  int middle;
+  union { char c; short d; };
+  struct { int e; };
+};
+)",
+                             {}),
+        "extraction failed");
+
+  auto outer = findRecords(sink.Records, "c:@S@Outer");
+  check(outer.size() == 1, "Outer isn't emitted once");
+  if (outer.size() != 1 || outer.front()->fields.size() != 4) {
+    check(false, "Outer doesn't have 4 fields");
+    return;
+  }
+  const char *anonymousIDs[] = {"c:@S@Outer@FI@0@Ua", nullptr,
+                                "c:@S@Outer@FI@2@Ua", "c:@S@Outer@FI@3@Sa"};
+  for (size_t i = 0; i < 4; ++i) {
+    if (!anonymousIDs[i]) {
+      continue;
+    }
+    llvm::StringRef id = anonymousIDs[i];
+    check(findRecords(sink.Records, id).size() == 1,
+          id + " isn't emitted once");
+    check(outer.front()->fields[i].type.declID == id,
+          "field " + llvm::Twine(i) + " of Outer doesn't refer to " + id);
+  }
+}
+
+// A `using` alias can be a root, and is emitted as a typedef along with the
+//  types it references.
+void testAliasRoot() {
+  ExtractorOptions options;
+  options.rootNames = {"Alias"};
+  CollectingSink sink;
+  check(extractTypesFromCode(sink, R"(
+struct Target { int a; };
+using Alias = Target *;
+struct Unrelated { int b; };
+)",
+                             {"-xc++"}, options),
+        "extraction failed");
+
+  auto alias = llvm::count_if(sink.Records, [](const TypeRecord &record) {
+    return record.kind == TypeKind::Typedef && record.type.typeName == "Alias";
+  });
+  check(alias == 1, "Alias isn't emitted once as a typedef");
+  check(findRecords(sink.Records, "c:@S@Target").size() == 1,
+        "Target isn't emitted once");
+  check(findRecords(sink.Records, "c:@S@Unrelated").empty(),
+        "Unrelated is emitted");
+}
+
+// The extract profile doesn't change the output, in C (where it skips
+//  function bodies) or C++ (where a body instantiates a specialization).
+void testExtractProfileOutput() {
+  ExtractorOptions extract;
+  extract.frontendProfile = FrontendProfile::Extract;
+  llvm::StringRef c = R"(
+struct S { int a; };
+static inline int get(struct S *s) {
+  struct Local { int b; } l = {s->a};
+  return l.b;
+}
+)";
+  check(extractJSON(c, {"-xc"}, extract) == extractJSON(c, {"-xc"}),
+        "the extract profile changes the output in C");
+
+  llvm::StringRef cpp = R"(
+template <typename T> struct Box { T value; };
+struct Holder { Box<int> *box; };
+inline int unbox(Holder h) { return h.box->value; }
+)";
+  check(extractJSON(cpp, {"-xc++"}, extract) == extractJSON(cpp, {"-xc++"}),
+        "the extract profile changes the output in C++");
+}
+
+// A cycle through a pointer is broken at the pointer, so a record still
+//  comes after the one it contains by value.
+void testPointerCycleOrder() {
+  CollectingSink sink;
+  check(extractTypesFromCode(sink, R"(
+struct A { struct B *b; };
+struct B { struct A a; };
+)",
+                             {}),
+        "extraction failed");
+
+  auto position = [&](llvm::StringRef declID) {
+    return llvm::find_if(sink.Records, [&](const TypeRecord &record) {
+             return record.type.declID == declID && record.isDefinition;
+           }) -
+           sink.Records.begin();
+  };
+  auto a = position("c:@S@A");
+  auto b = position("c:@S@B");
+  check(a < ptrdiff_t(sink.Records.size()) &&
+            b < ptrdiff_t(sink.Records.size()),
+        "A or B isn't emitted as a definition");
+  check(a < b, "B is emitted before A, which it contains");
+}
+
+// Types behind block pointers and inside `_Atomic` are part of a root's
+//  closure.
+void testRootClosureThroughBlocksAndAtomics() {
+  ExtractorOptions options;
+  options.rootNames = {"Handler", "Holder"};
+  CollectingSink sink;
+  check(extractTypesFromCode(sink, R"(
+struct Event { int code; };
+typedef void (^Handler)(struct Event *event);
+struct Value { int x; };
+struct Holder { _Atomic(struct Value) value; };
+)",
+                             {"-fblocks"}, options),
+        "extraction failed");
+
+  check(findRecords(sink.Records, "c:@S@Event").size() == 1,
+        "Event isn't emitted once");
+  check(findRecords(sink.Records, "c:@S@Value").size() == 1,
+        "Value isn't emitted once");
+}
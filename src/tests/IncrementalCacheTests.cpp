@@ -0,0 +1,54 @@
+#include "Tests.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+// A declaration after an `#include` depends on the included file (here,
+//  through a macro), even though the included file's contents come after it
+//  in the source manager, so changing the file invalidates its record.
+void testIncrementalCacheIncludedMacro() {
+  llvm::SmallString<128> directory;
+  if (llvm::sys::fs::createUniqueDirectory("te-tests", directory)) {
+    check(false, "can't create a temporary directory");
+    return;
+  }
+  std::vector<std::string> args = {("-I" + directory).str()};
+  ExtractorOptions cached;
+  cached.incrementalCachePath = (directory + "/cache").str();
+  llvm::StringRef code = "#include \"a.h\"\n"
+                         "struct S { char b[N]; };\n";
+
+  for (llvm::StringRef size : {"16", "32", "32"}) {
+    writeFile(directory + "/a.h", ("#define N " + size + "\n").str());
+    auto expected = extractJSON(code, args);
+    check(extractJSON(code, args, cached) == expected,
+          "the cached output differs with N = " + size);
+  }
+  llvm::sys::fs::remove_directories(directory);
+}
+
+// A root's dependencies are emitted before it even if they're declared in a
+//  later file, which its record doesn't depend on but its hash does, so
+//  changing them invalidates its record too.
+void testIncrementalCacheLaterDependency() {
+  llvm::SmallString<128> directory;
+  if (llvm::sys::fs::createUniqueDirectory("te-tests", directory)) {
+    check(false, "can't create a temporary directory");
+    return;
+  }
+  std::vector<std::string> args = {("-I" + directory).str()};
+  ExtractorOptions uncached;
+  uncached.rootNames = {"f"};
+  ExtractorOptions cached = uncached;
+  cached.incrementalCachePath = (directory + "/cache").str();
+  llvm::StringRef code = "struct B;\n"
+                         "void f(struct B *b);\n"
+                         "#include \"b.h\"\n";
+
+  for (llvm::StringRef type : {"int", "long", "long"}) {
+    writeFile(directory + "/b.h", ("struct B { " + type + " x; };\n").str());
+    auto expected = extractJSON(code, args, uncached);
+    check(extractJSON(code, args, cached) == expected,
+          "the cached output differs with " + type + " x");
+  }
+  llvm::sys::fs::remove_directories(directory);
+}
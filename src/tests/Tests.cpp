@@ -0,0 +1,33 @@
+#include "Tests.h"
+#include "TypeExtractorSession.h"
+#include <llvm/Support/raw_ostream.h>
+
+static bool failed = false;
+
+void check(bool condition, const llvm::Twine &message) {
+  if (!condition) {
+    llvm::errs() << "te-tests: " << message << "\n";
+    failed = true;
+  }
+}
+
+bool hasFailed() { return failed; }
+
+std::string extractJSON(llvm::StringRef code,
+                        const std::vector<std::string> &args,
+                        ExtractorOptions options) {
+  std::string output;
+  llvm::raw_string_ostream OS(output);
+  JSONStreamSink sink(OS);
+  check(extractTypesFromCode(sink, code, args, std::move(options)),
+        "extraction failed");
+  OS.flush();
+  return output;
+}
+
+void writeFile(const llvm::Twine &path, llvm::StringRef contents) {
+  std::error_code error;
+  llvm::raw_fd_ostream OS(path.str(), error);
+  check(!error, "can't write " + path);
+  OS << contents;
+}
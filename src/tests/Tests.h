@@ -0,0 +1,67 @@
+#include "RecordSink.h"
+#include "TypeExtractorAction.h"
+#include "TypeRecord.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <string>
+#include <vector>
+
+#ifndef TYPE_EXTRACTOR_TESTS_H
+#define TYPE_EXTRACTOR_TESTS_H
+
+// Each test is a function that reports its failures through `check`, and is
+//  run by CTest as `te-tests <name>` (see main.cpp).
+
+// Fail the current test with `message` unless `condition` holds.
+void check(bool condition, const llvm::Twine &message);
+
+// Whether any `check` has failed.
+bool hasFailed();
+
+// Extract `code` as the default JSON output, checking that it succeeds.
+std::string extractJSON(llvm::StringRef code,
+                        const std::vector<std::string> &args,
+                        ExtractorOptions options = {});
+
+// Write a file, checking that it succeeds.
+void writeFile(const llvm::Twine &path, llvm::StringRef contents);
+
+// Keeps copies of the records of an extraction, so that they outlive it.
+class CollectingSink : public RecordSink {
+private:
+  llvm::BumpPtrAllocator Allocator;
+  llvm::StringSaver Saver{Allocator};
+
+public:
+  std::vector<TypeRecord> Records;
+
+  void handleRecord(const TypeRecord &record) override {
+    Records.push_back(copyTypeRecord(record, Saver));
+  }
+};
+
+// The records with the declaration ID.
+inline std::vector<const TypeRecord *>
+findRecords(const std::vector<TypeRecord> &records, llvm::StringRef declID) {
+  std::vector<const TypeRecord *> found;
+  for (const auto &record : records) {
+    if (record.type.declID == declID) {
+      found.push_back(&record);
+    }
+  }
+  return found;
+}
+
+void testAnonymousRecordIDs();
+void testAliasRoot();
+void testExtractProfileOutput();
+void testPointerCycleOrder();
+void testRootClosureThroughBlocksAndAtomics();
+void testIncrementalCacheIncludedMacro();
+void testIncrementalCacheLaterDependency();
+void testBinaryMatchesJSON();
+void testDedupStoreOwners();
+
+#endif // TYPE_EXTRACTOR_TESTS_H
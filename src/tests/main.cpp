@@ -0,0 +1,36 @@
+#include "Tests.h"
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/raw_ostream.h>
+
+static const std::pair<llvm::StringRef, void (*)()> tests[] = {
+    {"anonymous-record-ids", testAnonymousRecordIDs},
+    {"alias-root", testAliasRoot},
+    {"extract-profile-output", testExtractProfileOutput},
+    {"pointer-cycle-order", testPointerCycleOrder},
+    {"root-closure-blocks-atomics", testRootClosureThroughBlocksAndAtomics},
+    {"incremental-cache-included-macro", testIncrementalCacheIncludedMacro},
+    {"incremental-cache-later-dependency",
+     testIncrementalCacheLaterDependency},
+    {"binary-matches-json", testBinaryMatchesJSON},
+    {"dedup-store-owners", testDedupStoreOwners},
+};
+
+// Run the named tests, or all of them.
+int main(int argc, char **argv) {
+  std::vector<llvm::StringRef> names(argv + 1, argv + argc);
+  if (names.empty()) {
+    for (const auto &test : tests) {
+      names.push_back(test.first);
+    }
+  }
+  for (auto name : names) {
+    auto test = llvm::find_if(
+        tests, [&](const auto &test) { return test.first == name; });
+    if (test == std::end(tests)) {
+      llvm::errs() << "te-tests: unknown test '" << name << "'\n";
+      return 1;
+    }
+    test->second();
+  }
+  return hasFailed() ? 1 : 0;
+}